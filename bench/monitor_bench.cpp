@@ -0,0 +1,484 @@
+// Microbenchmarks for the LinuxParser entry points, the System refresh
+// cycle and the formatting helpers. Every benchmark reads a fixture tree
+// written by proc_generator with a fixed seed, so results only change
+// when the code does. One JSON object per benchmark is written to stdout:
+//
+//   {"benchmark":"System::Processes","processes":10000,"threads":8,
+//    "iterations":64,"ns_per_op":...,"allocs_per_op":...,
+//    "syscalls_per_op":...}
+//
+// Time is measured in process, allocations with the Profiler's counting
+// operator new. System calls are counted in a child traced with ptrace,
+// which covers calls made inside glibc and libstdc++ and by the scanner
+// threads; they are null where tracing is not permitted. Fixtures are
+// written once below --fixture; delete them after changing the generator.
+#include <signal.h>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "cgroup_table.h"
+#include "device_stats.h"
+#include "format.h"
+#include "linux_parser.h"
+#include "ncurses_display.h"
+#include "proc_scanner.h"
+#include "process_table.h"
+#include "profiler.h"
+#include "system.h"
+#include "thread_table.h"
+
+using std::string;
+using std::vector;
+
+namespace {
+// Results are stored here so the calls are not optimized away
+volatile std::size_t sink;
+
+const long kSyscallIterations{10};
+// The per process entry points read this pid, which every fixture has
+const int kPid{1};
+
+struct Settings {
+  string fixture{BENCH_FIXTURE};
+  vector<long> processes{1000, 10000, 100000};
+  long minTimeMs{200};
+  string filter;
+  int threads{ProcScanner::DefaultThreads()};
+};
+
+// setup runs before measuring and returns the operation to measure; it
+// is run again in the traced child, which does not share its threads
+struct Benchmark {
+  string name;
+  long processes;
+  std::function<std::function<void()>()> setup;
+};
+
+struct Result {
+  long iterations{0};
+  double nsPerOp{0};
+  double allocsPerOp{0};
+  double syscallsPerOp{-1};  // negative when tracing failed
+};
+
+string FixtureRoot(const Settings& settings, long processes) {
+  return settings.fixture + "/" + std::to_string(processes);
+}
+
+// Writes the fixture tree for a process count unless it already exists.
+// The cgroup hierarchy is written last, so a tree without it, or without
+// the threads or io of init, or the device counters, is from an older
+// generator, or incomplete, and is written again from scratch.
+bool MakeFixture(const Settings& settings, long processes) {
+  string root{FixtureRoot(settings, processes)};
+  bool complete{true};
+  for (const char* file :
+       {"/sys/fs/cgroup/cgroup.controllers", "/proc/1/task/1/stat",
+        "/proc/1/io", "/proc/net/dev"}) {
+    complete = complete && access((root + file).c_str(), R_OK) == 0;
+  }
+  if (complete) {
+    return true;
+  }
+  std::fprintf(stderr, "writing fixture %s\n", root.c_str());
+  string command{"rm -rf '" + root + "' && mkdir -p '" + settings.fixture +
+                 "' && '" PROC_GENERATOR "' '" + root + "' -n " +
+                 std::to_string(processes) + " -c 8 -s 1 > /dev/null"};
+  return std::system(command.c_str()) == 0;
+}
+
+// Doubles the batch until it runs for at least minTimeMs, then reports
+// the last batch
+void Measure(const Benchmark& benchmark, long minTimeMs, Result& result) {
+  auto operation = benchmark.setup();
+  operation();  // files are opened and buffers sized on first use
+  auto minTime = std::chrono::milliseconds(minTimeMs);
+  for (long iterations{1};; iterations *= 2) {
+    long long before = Profiler::Allocations();
+    auto start = std::chrono::steady_clock::now();
+    for (long i{0}; i < iterations; ++i) {
+      operation();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    long long allocated = Profiler::Allocations() - before;
+    if (elapsed >= minTime || iterations >= (1L << 30)) {
+      result.iterations = iterations;
+      result.nsPerOp =
+          std::chrono::duration<double, std::nano>(elapsed).count() /
+          iterations;
+      result.allocsPerOp = static_cast<double>(allocated) / iterations;
+      return;
+    }
+  }
+}
+
+// Runs the benchmark in a child stopped at every system call. The child
+// raises SIGSTOP once set up and warmed up; the tracer counts syscall
+// entries of all its threads from then on, less the final exit_group.
+double CountSyscalls(const Benchmark& benchmark) {
+  pid_t child = fork();
+  if (child < 0) {
+    return -1;
+  }
+  if (child == 0) {
+    if (ptrace(PTRACE_TRACEME, 0, nullptr, nullptr) != 0) {
+      _exit(1);
+    }
+    raise(SIGSTOP);
+    auto operation = benchmark.setup();
+    operation();
+    raise(SIGSTOP);
+    for (long i{0}; i < kSyscallIterations; ++i) {
+      operation();
+    }
+    _exit(0);
+  }
+
+  int status{0};
+  if (waitpid(child, &status, 0) != child || !WIFSTOPPED(status)) {
+    return -1;
+  }
+  ptrace(PTRACE_SETOPTIONS, child, nullptr,
+         PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACECLONE | PTRACE_O_EXITKILL);
+  ptrace(PTRACE_SYSCALL, child, nullptr, nullptr);
+
+  bool counting{false};
+  bool succeeded{false};
+  long count{0};
+  pid_t thread;
+  while ((thread = waitpid(-1, &status, __WALL)) > 0) {
+    if (WIFEXITED(status) || WIFSIGNALED(status)) {
+      if (thread == child) {
+        succeeded = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+      }
+      continue;
+    }
+    int signal{0};
+    if (WSTOPSIG(status) == (SIGTRAP | 0x80)) {
+      __ptrace_syscall_info info{};
+      if (counting &&
+          ptrace(PTRACE_GET_SYSCALL_INFO, thread, sizeof(info), &info) > 0 &&
+          info.op == PTRACE_SYSCALL_INFO_ENTRY) {
+        ++count;
+      }
+    } else if (status >> 16 != 0) {
+      // PTRACE_EVENT_CLONE, the new thread is traced from its start
+    } else if (WSTOPSIG(status) == SIGSTOP) {
+      // The marker, or the initial stop of a new thread
+      if (thread == child) {
+        counting = true;
+        count = 0;
+      }
+    } else {
+      signal = WSTOPSIG(status);
+    }
+    ptrace(PTRACE_SYSCALL, thread, nullptr, signal);
+  }
+  if (!succeeded || !counting) {
+    return -1;
+  }
+  return static_cast<double>(count - 1) / kSyscallIterations;
+}
+
+// Per file entry points run against the smallest fixture, the scans
+// against each fixture size
+vector<Benchmark> Benchmarks(const Settings& settings) {
+  vector<Benchmark> benchmarks;
+  long smallest{settings.processes.front()};
+  string small{FixtureRoot(settings, smallest)};
+  auto add = [&benchmarks, smallest, small](const string& name,
+                                            std::function<void()> body) {
+    benchmarks.push_back({name, smallest, [small, body]() {
+                            LinuxParser::SetRoot(small);
+                            return body;
+                          }});
+  };
+
+  add("LinuxParser::ReadFile", []() {
+    static vector<char> buffer;
+    sink = LinuxParser::ReadFile(LinuxParser::ProcDirectory() +
+                                     LinuxParser::kStatFilename,
+                                 buffer);
+  });
+  add("LinuxParser::MemoryUtilization",
+      []() { sink = LinuxParser::MemoryUtilization() > 0; });
+  add("LinuxParser::UpTime", []() { sink = LinuxParser::UpTime(); });
+  add("LinuxParser::TotalProcesses",
+      []() { sink = LinuxParser::TotalProcesses(); });
+  add("LinuxParser::RunningProcesses",
+      []() { sink = LinuxParser::RunningProcesses(); });
+  add("LinuxParser::OperatingSystem",
+      []() { sink = LinuxParser::OperatingSystem().size(); });
+  add("LinuxParser::Kernel", []() { sink = LinuxParser::Kernel().size(); });
+  add("LinuxParser::CpuUtilization",
+      []() { sink = LinuxParser::CpuUtilization().size(); });
+  add("LinuxParser::Jiffies", []() { sink = LinuxParser::Jiffies(); });
+  add("LinuxParser::ActiveJiffies",
+      []() { sink = LinuxParser::ActiveJiffies(); });
+  add("LinuxParser::IdleJiffies", []() { sink = LinuxParser::IdleJiffies(); });
+  add("LinuxParser::ActiveJiffies(pid)",
+      []() { sink = LinuxParser::ActiveJiffies(kPid) > 0; });
+  add("LinuxParser::ParseProcStat(pid)", []() {
+    LinuxParser::ProcStatRecord record;
+    sink = LinuxParser::ParseProcStat(kPid, record);
+  });
+  add("LinuxParser::ParseProcStat(buffer)", []() {
+    static vector<char> buffer;
+    static std::size_t length{LinuxParser::ReadFile(
+        LinuxParser::ProcDirectory() + "1" + LinuxParser::kStatFilename,
+        buffer)};
+    LinuxParser::ProcStatRecord record;
+    sink = LinuxParser::ParseProcStat(buffer.data(), length, record);
+  });
+  add("LinuxParser::ParseProcStatus(pid)", []() {
+    LinuxParser::ProcStatusRecord record;
+    sink = LinuxParser::ParseProcStatus(kPid, record);
+  });
+  add("LinuxParser::ParseProcStatus(buffer)", []() {
+    static vector<char> buffer;
+    static std::size_t length{LinuxParser::ReadFile(
+        LinuxParser::ProcDirectory() + "1" + LinuxParser::kStatusFilename,
+        buffer)};
+    LinuxParser::ProcStatusRecord record;
+    sink = LinuxParser::ParseProcStatus(buffer.data(), length, record);
+  });
+  add("LinuxParser::ParseSmapsRollup(pid)", []() {
+    LinuxParser::SmapsRollupRecord record;
+    sink = LinuxParser::ParseSmapsRollup(kPid, record);
+  });
+  add("LinuxParser::ParseProcIo(pid)", []() {
+    LinuxParser::ProcIoRecord record;
+    sink = LinuxParser::ParseProcIo(kPid, record);
+  });
+  add("LinuxParser::Command",
+      []() { sink = LinuxParser::Command(kPid).size(); });
+  add("LinuxParser::Ram", []() { sink = LinuxParser::Ram(kPid).size(); });
+  add("LinuxParser::Uid", []() { sink = LinuxParser::Uid(kPid).size(); });
+  add("LinuxParser::User", []() { sink = LinuxParser::User(kPid).size(); });
+  add("LinuxParser::UserName",
+      []() { sink = LinuxParser::UserName(1000).size(); });
+  add("LinuxParser::UpTime(pid)",
+      []() { sink = LinuxParser::UpTime(kPid); });
+  add("DeviceStats::Refresh", []() {
+    static DeviceStats devices;
+    devices.Refresh();
+    sink = devices.Disks().size() + devices.Networks().size();
+  });
+  add("Format::ElapsedTime",
+      []() { sink = Format::ElapsedTime(93784).size(); });
+  add("NCursesDisplay::ProgressBar",
+      []() { sink = NCursesDisplay::ProgressBar(0.42f).size(); });
+
+  for (long processes : settings.processes) {
+    string root{FixtureRoot(settings, processes)};
+    int threads{settings.threads};
+    benchmarks.push_back({"LinuxParser::Pids", processes, [root]() {
+                            LinuxParser::SetRoot(root);
+                            return std::function<void()>([]() {
+                              static vector<int> pids;
+                              LinuxParser::Pids(pids);
+                              sink = pids.size();
+                            });
+                          }});
+    benchmarks.push_back(
+        {"System::Refresh", processes, [root, threads]() {
+           LinuxParser::SetRoot(root);
+           auto system = std::make_shared<System>(threads);
+           return std::function<void()>([system]() { system->Refresh(); });
+         }});
+    benchmarks.push_back(
+        {"System::Processes", processes, [root, threads]() {
+           LinuxParser::SetRoot(root);
+           auto system = std::make_shared<System>(threads);
+           return std::function<void()>([system]() {
+             system->ScanProcesses();
+             sink = system->Rank(10);
+           });
+         }});
+    // The same sorted by I/O, which also reads io of every process
+    benchmarks.push_back(
+        {"System::Processes(io)", processes, [root, threads]() {
+           LinuxParser::SetRoot(root);
+           auto system = std::make_shared<System>(threads);
+           system->SetSortKey(SortKey::kIo);
+           return std::function<void()>([system]() {
+             system->ScanProcesses();
+             sink = system->Rank(10);
+           });
+         }});
+    // One tick of the display: refresh, scan and the frame of the top 10
+    benchmarks.push_back(
+        {"System::Collect", processes, [root, threads]() {
+           LinuxParser::SetRoot(root);
+           auto system = std::make_shared<System>(threads);
+           auto frame = std::make_shared<Frame>();
+           return std::function<void()>([system, frame]() {
+             system->Collect(*frame, 10);
+             sink = frame->rows.size();
+           });
+         }});
+    // Summing the scanned table up by user, without the scan itself
+    benchmarks.push_back(
+        {"ProcessTable::Aggregate", processes, [root, threads]() {
+           LinuxParser::SetRoot(root);
+           ProcScanner scanner(threads);
+           vector<int> pids;
+           vector<ProcSample> samples;
+           LinuxParser::Pids(pids);
+           scanner.Scan(pids, samples, true);
+           auto table = std::make_shared<ProcessTable>();
+           table->Update(pids, samples, 0.0);
+           auto groups = std::make_shared<vector<ProcessGroup>>();
+           return std::function<void()>([table, groups]() {
+             table->Aggregate(GroupBy::kUser, *groups);
+             sink = groups->size();
+           });
+         }});
+    // The counters of every cgroup of the fixture, without the walk
+    benchmarks.push_back(
+        {"CgroupTable::Refresh", processes, [root]() {
+           LinuxParser::SetRoot(root);
+           auto cgroups = std::make_shared<CgroupTable>();
+           cgroups->Scan();
+           return std::function<void()>([cgroups]() {
+             cgroups->Refresh();
+             sink = cgroups->Groups().size();
+           });
+         }});
+    // The threads of ten multi-threaded processes, like the rows of the
+    // thread view
+    benchmarks.push_back(
+        {"ThreadTable::Read", processes, [root, threads]() {
+           LinuxParser::SetRoot(root);
+           ProcScanner scanner(threads);
+           vector<int> pids;
+           vector<ProcSample> samples;
+           LinuxParser::Pids(pids);
+           scanner.Scan(pids, samples, false);
+           auto table = std::make_shared<ProcessTable>();
+           table->Update(pids, samples, 0.0);
+           auto shown = std::make_shared<vector<Process*>>();
+           for (Process& process : table->Entries()) {
+             if (process.Threads() > 1 && shown->size() < 10) {
+               shown->push_back(&process);
+             }
+           }
+           auto tasks = std::make_shared<ThreadTable>();
+           return std::function<void()>([table, shown, tasks]() {
+             tasks->Read(*shown, 0.0);
+             sink = tasks->Threads().size();
+           });
+         }});
+    // The first screen of the tree, once the sums are rolled up
+    benchmarks.push_back(
+        {"ProcessTree::Flatten", processes, [root, threads]() {
+           LinuxParser::SetRoot(root);
+           ProcScanner scanner(threads);
+           vector<int> pids;
+           vector<ProcSample> samples;
+           LinuxParser::Pids(pids);
+           scanner.Scan(pids, samples, false);
+           auto table = std::make_shared<ProcessTable>();
+           table->Update(pids, samples, 0.0);
+           auto lines = std::make_shared<vector<TreeLine>>();
+           return std::function<void()>([table, lines]() {
+             sink = table->Tree().Flatten(SortKey::kCpu, 0, 10, *lines);
+           });
+         }});
+  }
+  return benchmarks;
+}
+
+void Usage(const char* program) {
+  std::fprintf(stderr,
+               "usage: %s [options]\n"
+               "  --fixture DIR       fixture trees (%s)\n"
+               "  --processes N,...   fixture sizes (1000,10000,100000)\n"
+               "  --min-time MS       time per benchmark (200)\n"
+               "  --filter TEXT       only benchmarks whose name has TEXT\n"
+               "  -t, --threads N     threads scanning /proc\n",
+               program, BENCH_FIXTURE);
+}
+
+bool Parse(int argc, char* argv[], Settings& settings) {
+  for (int i{1}; i < argc; ++i) {
+    string arg{argv[i]};
+    if (i + 1 >= argc) {
+      return false;
+    }
+    string value{argv[++i]};
+    try {
+      if (arg == "--fixture") {
+        settings.fixture = value;
+      } else if (arg == "--processes") {
+        settings.processes.clear();
+        for (std::size_t begin{0}; begin < value.size();) {
+          std::size_t end = value.find(',', begin);
+          end = end == string::npos ? value.size() : end;
+          settings.processes.push_back(
+              std::stol(value.substr(begin, end - begin)));
+          begin = end + 1;
+        }
+      } else if (arg == "--min-time") {
+        settings.minTimeMs = std::stol(value);
+      } else if (arg == "--filter") {
+        settings.filter = value;
+      } else if (arg == "-t" || arg == "--threads") {
+        settings.threads = std::stoi(value);
+      } else {
+        return false;
+      }
+    } catch (const std::exception&) {
+      return false;
+    }
+  }
+  return !settings.processes.empty() && settings.threads > 0;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Settings settings;
+  if (!Parse(argc, argv, settings)) {
+    Usage(argv[0]);
+    return 2;
+  }
+  for (long processes : settings.processes) {
+    if (!MakeFixture(settings, processes)) {
+      std::fprintf(stderr, "could not write the fixture for %ld processes\n",
+                   processes);
+      return 1;
+    }
+  }
+
+  for (const Benchmark& benchmark : Benchmarks(settings)) {
+    if (benchmark.name.find(settings.filter) == string::npos) {
+      continue;
+    }
+    Result result;
+    result.syscallsPerOp = CountSyscalls(benchmark);
+    Measure(benchmark, settings.minTimeMs, result);
+    string syscalls{"null"};
+    if (result.syscallsPerOp >= 0) {
+      char number[32];
+      std::snprintf(number, sizeof(number), "%.2f", result.syscallsPerOp);
+      syscalls = number;
+    }
+    std::printf(
+        "{\"benchmark\":\"%s\",\"processes\":%ld,\"threads\":%d,"
+        "\"iterations\":%ld,\"ns_per_op\":%.1f,\"allocs_per_op\":%.2f,"
+        "\"syscalls_per_op\":%s}\n",
+        benchmark.name.c_str(), benchmark.processes, settings.threads,
+        result.iterations, result.nsPerOp, result.allocsPerOp,
+        syscalls.c_str());
+    std::fflush(stdout);
+  }
+  return 0;
+}
@@ -0,0 +1,44 @@
+#ifndef CANVAS_H
+#define CANVAS_H
+
+#include <curses.h>
+
+#include <cstddef>
+#include <vector>
+
+/*
+A window that remembers what was last written to each of its cells.
+Put() compares the new text of a field with the cells it covers and only
+touches the window when something differs, padding with blanks so a
+shorter value never leaves characters of the longer one behind. Flush()
+queues the window for the next doupdate() only if a Put() changed it.
+*/
+class Canvas {
+ public:
+  explicit Canvas(WINDOW* window);
+
+  WINDOW* Window() const;
+  int Width() const;
+  int Height() const;
+
+  // text is cut to width columns and padded with blanks up to it; control
+  // characters are shown as '?'. The right border column is never written.
+  void Put(int y, int x, int width, const char* text, attr_t attr = A_NORMAL);
+  void Printf(int y, int x, int width, attr_t attr, const char* format, ...)
+      __attribute__((format(printf, 6, 7)));
+  void Box();    // drawn once, again after Touch()
+  void Touch();  // the screen was covered, repaint all of it
+  void Flush();
+
+ private:
+  WINDOW* window_;
+  int width_;
+  int height_;
+  std::vector<char> text_;
+  std::vector<attr_t> attrs_;
+  char line_[512];
+  bool boxed_{false};
+  bool dirty_{true};
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef CGROUP_TABLE_H
+#define CGROUP_TABLE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "linux_parser.h"
+#include "string_pool.h"
+
+// One cgroup and the rates of its counters over the last interval
+struct Cgroup {
+  std::uint32_t path{};  // id of CgroupTable::Path()
+  LinuxParser::CgroupRecord counters{};
+  float cpu{};        // fraction of one core
+  float throttled{};  // fraction of the interval
+  double readBytesPerSecond{};
+  double writeBytesPerSecond{};
+  std::chrono::steady_clock::time_point sampled{};  // of counters
+};
+
+/*
+The groups of the cgroup v2 hierarchy, found by walking its mount under
+LinuxParser::CgroupDirectory(), or the unified mount below it on hosts
+that also mount v1 controllers. Scan() walks the directories to find
+groups that were created or removed; Refresh() rereads the counters of
+the groups found and turns them into rates. The kernel keeps the
+counters per group, subgroups included, so a service or container is
+measured directly instead of as the sum of its processes.
+
+A host may have more groups than descriptors to spare, so the files are
+opened for each read, into one buffer that is reused. Paths are
+interned, and their ids, from Id(), are what a process is mapped to.
+Id 0 is the empty path, for a process whose cgroup is not known. Every
+other id belongs to a group: Id() of a path the walk has not found yet
+adds its group, and when a Scan() no longer finds a group its id is
+released and handed to the next new group, so hosts that create and
+remove containers or scopes all the time keep Paths() at the number of
+groups alive. Known() tells whether an id handed out still holds.
+*/
+class CgroupTable {
+ public:
+  CgroupTable();
+  bool Scan();  // false if no cgroup v2 hierarchy is mounted
+  void Refresh();
+  const std::vector<Cgroup>& Groups() const;
+  std::uint32_t Id(std::string_view path);
+  bool Known(std::uint32_t id) const;
+  std::string_view Path(std::uint32_t id) const;
+  std::size_t Paths() const;  // above the largest id in use
+
+ private:
+  bool FindMount();
+  std::size_t Slot(std::string_view path);
+  void Walk();
+  std::size_t Read(const char* filename);
+
+  std::string mount_ = {};
+  StringPool paths_ = {};
+  std::vector<Cgroup> groups_ = {};
+  std::vector<unsigned> seen_ = {};  // generation a group was last seen in
+  std::unordered_map<std::uint32_t, std::size_t> slots_ = {};  // by path
+  unsigned generation_{};
+  std::string path_ = {};  // mount_ and the group being walked or read
+  std::vector<char> buffer_ = std::vector<char>(4096);
+};
+
+#endif
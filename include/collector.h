@@ -0,0 +1,72 @@
+#ifndef COLLECTOR_H
+#define COLLECTOR_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "group_by.h"
+#include "history_ring.h"
+#include "scheduler.h"
+#include "sort_key.h"
+#include "system.h"
+
+/*
+Refreshes a System on a thread of its own, at the Scheduler's rates, so
+a slow /proc read never stalls drawing and slow terminal output never
+delays sampling. Every refresh is filled into System::Back() and
+published through System::Publish() for the renderer to pick up with
+System::Latest(), and Notifier(), an eventfd, becomes readable so the
+renderer can poll() on it together with its input. Frames with new
+rows also go to the recorder, if any.
+
+Once started, the System belongs to the collecting thread; the renderer
+only calls Latest() and asks for a sort key, grouping, tree or thread
+view through SetSortKey(), SetGroupBy(), SetTreeView(), SetTreeOffset(),
+Toggle() and SetThreadView().
+*/
+class Collector {
+ public:
+  Collector(System& system, std::size_t n, HistoryRing* recorder = nullptr);
+  ~Collector();
+  Collector(const Collector&) = delete;
+  Collector& operator=(const Collector&) = delete;
+
+  bool Start();
+  void Stop();
+  void SetSortKey(SortKey key);
+  void SetGroupBy(GroupBy by);
+  void SetTreeView(bool tree);
+  void SetTreeOffset(std::size_t offset);
+  void Toggle(int pid);  // collapses or expands pid in the tree view
+  void SetThreadView(bool threads, int pid);  // pid 0 for those of the rows
+  int Notifier() const;
+  void Acknowledge();  // makes Notifier() wait for the next publish
+
+ private:
+  void Run();
+  bool Refresh(Scheduler& scheduler, Scheduler::Clock::time_point now,
+               Frame& frame);
+
+  System& system_;
+  std::size_t n_;
+  HistoryRing* recorder_;
+  int notifier_{-1};
+  std::thread thread_ = {};
+
+  // Only wakes the thread early; the snapshots need no lock
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  SortKey sortKey_;
+  GroupBy groupBy_;
+  bool treeView_;
+  std::size_t treeOffset_;
+  std::vector<int> toggles_ = {};  // pids to collapse or expand
+  bool threadView_;
+  int threadPid_;
+  bool stop_{false};
+};
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef DEVICE_STATS_H
+#define DEVICE_STATS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "linux_parser.h"
+#include "proc_file.h"
+#include "string_pool.h"
+
+// A block device and its rates over the last interval
+struct DiskStat {
+  std::uint32_t name{};  // id of DeviceStats::Name()
+  double readsPerSecond{};
+  double writesPerSecond{};
+  double readBytesPerSecond{};
+  double writeBytesPerSecond{};
+  float utilization{};  // fraction of the interval the device was busy
+  float queueDepth{};   // requests in flight, on average
+};
+
+// A network interface and its rates over the last interval
+struct NetStat {
+  std::uint32_t name{};
+  double rxBytesPerSecond{};
+  double txBytesPerSecond{};
+  double rxPacketsPerSecond{};
+  double txPacketsPerSecond{};
+  double rxDropsPerSecond{};
+  double txDropsPerSecond{};
+};
+
+/*
+Throughput of the block devices in /proc/diskstats and the interfaces in
+/proc/net/dev. Both files stay open and Refresh() rereads each once,
+like SystemSnapshot, turning the counters into rates against the
+previous Refresh().
+
+Device names are interned, and the counters kept in arrays indexed by
+the name's id. Devices come in the same order every time, so each line
+is first checked against the device of the same line last time, by its
+major and minor number or by comparing the name; only a line that
+differs, once a device was added or removed, looks its name up in the
+pool. Steady state refreshes neither hash nor allocate.
+
+Partitions are left out of Disks(), their I/O is already counted by
+their disk, and so are devices that never did any I/O, like unused loop
+devices.
+*/
+class DeviceStats {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  bool Refresh();
+  const std::vector<DiskStat>& Disks() const;  // in /proc/diskstats order
+  const std::vector<NetStat>& Networks() const;
+  std::string_view Name(std::uint32_t id) const;
+
+ private:
+  // Counters of one device, indexed by name id; sampled is zero for ids
+  // that are not a device of that kind
+  struct DiskCounters {
+    LinuxParser::DiskRecord record{};
+    Clock::time_point sampled{};
+    bool partition{};
+  };
+  struct NetCounters {
+    LinuxParser::NetRecord record{};
+    Clock::time_point sampled{};
+  };
+
+  static std::size_t Read(ProcFile& file, const std::string& filename);
+  bool RefreshDisks(Clock::time_point now);
+  bool RefreshNetworks(Clock::time_point now);
+  std::uint32_t DiskId(std::size_t line,
+                       const LinuxParser::DiskRecord& record);
+  std::uint32_t NetId(std::size_t line, const LinuxParser::NetRecord& record);
+
+  ProcFile diskstats_ = {};
+  ProcFile netDev_ = {};
+  StringPool names_ = {};
+  std::vector<DiskCounters> diskCounters_ = {};  // by name id
+  std::vector<NetCounters> netCounters_ = {};    // by name id
+  std::vector<std::uint32_t> diskLines_ = {};  // name id of each line
+  std::vector<std::uint32_t> netLines_ = {};
+  std::vector<DiskStat> disks_ = {};
+  std::vector<NetStat> networks_ = {};
+};
+
+#endif
@@ -1,10 +1,12 @@
 #ifndef FORMAT_H
 #define FORMAT_H
 
+#include <cstddef>
 #include <string>
 
 namespace Format {
 std::string ElapsedTime(long time_target);  // TODO: See src/format.cpp
+void ElapsedTime(long seconds, char* buffer, std::size_t size);
 };                                          // namespace Format
 
 #endif
\ No newline at end of file
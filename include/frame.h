@@ -0,0 +1,137 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <cstdint>
+#include <vector>
+
+#include "group_by.h"
+#include "sort_key.h"
+
+/*
+Everything collected in one tick: the system wide figures and the top
+processes, with display-ready values. Text is held in fixed arrays so a
+Frame that is refilled every tick stops allocating once its vectors
+have grown to size.
+*/
+struct ProcessRow {
+  int pid{};
+  float cpu{};    // fraction of one core
+  long rssMb{};
+  long pssMb{};  // this and below -1 if unknown
+  long sharedMb{};
+  long privateMb{};
+  long swapMb{};
+  long readKbPerSecond{};  // from io, over the last interval
+  long writeKbPerSecond{};
+  float readCallsPerSecond{};
+  float writeCallsPerSecond{};
+  long upTime{};  // seconds
+  char user[32]{};
+  char command[256]{};
+};
+
+// One block device, rates over the last interval
+struct DiskRow {
+  char name[32]{};
+  float readsPerSecond{};
+  float writesPerSecond{};
+  long readKbPerSecond{};
+  long writeKbPerSecond{};
+  float utilization{};  // fraction of the interval the device was busy
+  float queueDepth{};   // requests in flight, on average
+};
+
+// One network interface, rates over the last interval
+struct NetRow {
+  char name[32]{};
+  long rxKbPerSecond{};
+  long txKbPerSecond{};
+  float rxPacketsPerSecond{};
+  float txPacketsPerSecond{};
+  float rxDropsPerSecond{};
+  float txDropsPerSecond{};
+};
+
+// One group of processes when the list is grouped
+struct GroupRow {
+  char name[64]{};  // user or command name
+  int processes{};
+  float cpu{};  // fraction of one core, summed
+  long rssMb{};
+};
+
+// One cgroup when the list is grouped by cgroup, measured by the kernel's
+// counters of the group, subgroups included
+struct CgroupRow {
+  char path[128]{};
+  int processes{};  // in the group itself
+  float cpu{};        // fraction of one core
+  float throttled{};  // fraction of the interval
+  long memoryMb{};
+  long anonMb{};
+  long fileMb{};
+  long readKbPerSecond{};
+  long writeKbPerSecond{};
+};
+
+// Where a row sits in the process tree, and the sums of its subtree
+struct TreeRow {
+  int depth{};
+  bool children{};
+  bool collapsed{};
+  int processes{};  // the process itself included
+  float cpu{};      // fraction of one core
+  long rssMb{};
+};
+
+// One thread, in thread view
+struct ThreadRow {
+  int pid{};
+  int tid{};
+  float cpu{};  // fraction of one core
+  char state{};
+  int processor{};  // CPU it last ran on
+  char name[16]{};
+};
+
+// The row fields a consumer of frames uses. Fields left out are not read
+// from /proc and stay empty, or -1; pid, CPU, RSS and time always come
+// from stat, which every scan reads.
+struct Columns {
+  bool user{true};     // uid from status
+  bool command{true};  // cmdline
+  bool swap{true};     // status
+  bool smaps{true};    // PSS, shared and private from smaps_rollup
+  bool io{true};       // read and write rates from io
+};
+
+struct Frame {
+  std::int64_t timestampMs{};  // wall clock, milliseconds since the epoch
+  char os[64]{};
+  char kernel[64]{};
+  float cpu{};  // fraction of all cores
+  std::vector<float> cores = {};
+  float memory{};
+  int totalProcesses{};
+  int runningProcesses{};
+  int shortLivedProcesses{};
+  long upTime{};  // seconds
+  double loadAverage[3]{};
+  std::vector<DiskRow> disks = {};  // busiest first
+  std::vector<NetRow> networks = {};
+  SortKey sortKey{SortKey::kMemory};
+  Columns columns{};  // those the rows carry, the others are not shown
+  std::vector<ProcessRow> rows = {};
+  GroupBy groupBy{GroupBy::kNone};
+  std::vector<GroupRow> groups = {};  // top groups, when grouped
+  std::vector<CgroupRow> cgroups = {};  // instead, by cgroup
+  bool treeView{false};  // rows are lines of the process tree
+  std::vector<TreeRow> tree = {};  // tree[i] belongs to rows[i]
+  long treeOffset{};  // lines of the tree above rows[0]
+  long treeSize{};    // lines of the tree in all
+  bool threadView{false};  // threads shows the threads of processes
+  int threadPid{};  // whose threads, 0 for those of the rows
+  std::vector<ThreadRow> threads = {};  // top threads, in sort key order
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef FRAME_WRITER_H
+#define FRAME_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "frame.h"
+
+/*
+Streams frames to a file descriptor, one record per frame, in one of:
+
+kJsonLines: one JSON object per line, with the rates of every disk and
+  network interface in "disks" and "networks". A grouped frame adds the top
+  groups as "users", "commands" or "cgroups". In tree view the processes
+  are lines of the tree, in order, each with its depth and subtree sums.
+  In thread view "threads" holds the top threads.
+
+kBinary: a little-endian uint32 byte count followed by the record:
+  uint16 version, int64 timestampMs, float32 cpu, float32 memory,
+  uint32 totalProcesses, uint32 runningProcesses, int64 upTime,
+  float64 loadAverage[3], uint16 cores, float32 core[cores],
+  uint16 rows, then per row: int32 pid, float32 cpu, int64 rssMb,
+  int64 pssMb, int64 sharedMb, int64 privateMb, int64 swapMb (-1 if
+  unknown), int64 upTime, uint8 length + user bytes, uint16 length +
+  command bytes. Devices, I/O rates, groups, tree fields and threads are
+  not part of binary records.
+
+Records are serialized into a buffer that is reused between frames and
+written with a single write().
+*/
+class FrameWriter {
+ public:
+  enum class Format { kJsonLines, kBinary };
+  static const std::uint16_t kBinaryVersion{2};
+
+  FrameWriter(int fd, Format format);
+  bool Write(const Frame& frame);
+
+ private:
+  void SerializeJson(const Frame& frame);
+  void SerializeBinary(const Frame& frame);
+
+  void Append(const char* data, std::size_t length);
+  void Append(const char* text);
+  void AppendNumber(long long value);
+  void AppendNumber(double value, int decimals);
+  void AppendJsonString(const char* text);
+  template <typename T>
+  void AppendRaw(T value);
+
+  int fd_{-1};
+  Format format_{Format::kJsonLines};
+  std::vector<char> buffer_ = {};
+  std::size_t length_{0};
+};
+
+#endif
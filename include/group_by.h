@@ -0,0 +1,7 @@
+#ifndef GROUP_BY_H
+#define GROUP_BY_H
+
+// What the process list can be summed up by, kNone lists every process
+enum class GroupBy { kNone, kUser, kCommand, kCgroup };
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include "history_ring.h"
+#include "options.h"
+#include "system.h"
+
+namespace Headless {
+int Run(System& system, const Options& options,
+        HistoryRing* recorder = nullptr);
+};  // namespace Headless
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef HISTORY_RING_H
+#define HISTORY_RING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "frame.h"
+
+/*
+Fixed-size ring of recorded frames in a memory-mapped file. The file is
+sized once, so disk use is bounded by the capacity, and appending a
+frame is a copy into the mapping: the kernel writes dirty pages back on
+its own schedule and nothing is synced per tick.
+
+Layout: a kHeaderSize header followed by capacity slots of slotSize
+bytes. Each slot is stored column by column so the same field of every
+row sits together:
+
+  SlotHeader | float core[cores] | int32 pid[rows] | float cpu[rows] |
+  int64 rssMb[rows] | int64 pssMb[rows] | int64 sharedMb[rows] |
+  int64 privateMb[rows] | int64 swapMb[rows] | int64 upTime[rows] |
+  char user[rows][32] | char command[rows][kCommandLength]
+
+Commands are truncated to kCommandLength - 1 characters.
+*/
+class HistoryRing {
+ public:
+  static const std::size_t kDefaultCapacity{21600};  // 6 hours at 1 Hz
+  static constexpr std::size_t kMaxCapacity{1000000};  // 11 days at 1 Hz
+  static const std::size_t kCommandLength{128};
+  // A slot counts its cores and rows in 16 bits
+  static constexpr std::uint32_t kMaxRows{65535};
+  static constexpr std::uint32_t kMaxCores{65535};
+
+  HistoryRing() = default;
+  ~HistoryRing();
+  HistoryRing(const HistoryRing&) = delete;
+  HistoryRing& operator=(const HistoryRing&) = delete;
+
+  // Opens filename for recording, continuing an existing ring of the same
+  // geometry or replacing the file with an empty ring
+  bool Create(const std::string& filename, std::size_t capacity, int rows,
+              int cores);
+  // Opens filename read-only for replay
+  bool Open(const std::string& filename);
+
+  void Append(const Frame& frame);
+  std::size_t Size() const;  // frames that can be read
+  bool Read(std::size_t index, Frame& frame) const;  // 0 is the oldest
+  std::int64_t Timestamp(std::size_t index) const;
+
+ private:
+  struct Header;
+  struct SlotHeader;
+  struct Layout {
+    std::size_t cores, pid, cpu, rssMb, pssMb, sharedMb, privateMb, swapMb,
+        upTime, user, command, size;
+  };
+
+  static Layout Plan(int rows, int cores);
+  bool Map(int fd, std::size_t length, bool writable);
+  void Unmap();
+  Header* Head() const;
+  std::uint64_t Written() const;
+  std::uint64_t Readable(std::uint64_t written) const;
+  char* Slot(std::uint64_t sequence) const;
+
+  char* data_{nullptr};
+  std::size_t length_{0};
+  Layout layout_ = {};
+};
+
+#endif
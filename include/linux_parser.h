@@ -1,28 +1,55 @@
 #ifndef SYSTEM_PARSER_H
 #define SYSTEM_PARSER_H
 
+#include <cstddef>
 #include <fstream>
 #include <numeric>
 #include <regex>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace LinuxParser {
-// Paths
+// Paths, below Root()
 const std::string kProcDirectory{"/proc/"};
 const std::string kCmdlineFilename{"/cmdline"};
 const std::string kCpuinfoFilename{"/cpuinfo"};
 const std::string kStatusFilename{"/status"};
 const std::string kStatFilename{"/stat"};
+const std::string kSmapsRollupFilename{"/smaps_rollup"};
+const std::string kCgroupFilename{"/cgroup"};
+const std::string kIoFilename{"/io"};
+const std::string kTaskDirectory{"/task/"};
 const std::string kUptimeFilename{"/uptime"};
 const std::string kMeminfoFilename{"/meminfo"};
+const std::string kLoadavgFilename{"/loadavg"};
 const std::string kVersionFilename{"/version"};
+const std::string kDiskstatsFilename{"/diskstats"};
+const std::string kNetDevFilename{"/net/dev"};
 const std::string kOSPath{"/etc/os-release"};
 const std::string kPasswordPath{"/etc/passwd"};
+const std::string kCgroupDirectory{"/sys/fs/cgroup"};
+
+// Every path the parser reads is prefixed with the root, "" for the live
+// system. Set it before creating a System; readers do not lock it.
+void SetRoot(const std::string& root);
+const std::string& Root();
+const std::string& ProcDirectory();
+const std::string& OSPath();
+const std::string& PasswordPath();
+const std::string& CgroupDirectory();
+
+// Raw file access
+std::size_t ReadFile(const std::string& filename, std::vector<char>& buffer);
+// Whether the entry name of the open directory directoryFd, of readdir()
+// type type, is a directory. Stats it only when the type is DT_UNKNOWN.
+bool IsDirectory(int directoryFd, const char* name, unsigned char type);
 
 // System
 float MemoryUtilization();
 long UpTime();
 std::vector<int> Pids();
+void Pids(std::vector<int>& pids);
 int TotalProcesses();
 int RunningProcesses();
 std::string OperatingSystem();
@@ -48,10 +75,121 @@ float ActiveJiffies(int pid);
 long IdleJiffies();
 
 // Processes
+// Fields of /proc/[pid]/stat used by the monitor, numbered as in proc(5)
+struct ProcStatRecord {
+  int pid{};                 // (1)
+  char comm[64]{};           // (2) without the surrounding parentheses
+  char state{};              // (3)
+  int ppid{};                // (4)
+  long utime{};              // (14) clock ticks in user mode
+  long stime{};              // (15) clock ticks in kernel mode
+  long cutime{};             // (16) waited-for children in user mode
+  long cstime{};             // (17) waited-for children in kernel mode
+  long numThreads{};         // (20)
+  unsigned long long startTime{};  // (22) clock ticks after boot
+  long rss{};                // (24) resident set size in pages
+  int processor{};           // (39) CPU last run on, see lastField
+};
+bool ParseProcStat(int pid, ProcStatRecord& record);
+bool ParseProcStat(const char* data, std::size_t length,
+                   ProcStatRecord& record, int lastField = 24);
+
+// The threads of a process, from /proc/[pid]/task. Each task's stat has
+// the fields of the process' stat, but counts only that thread's time.
+bool Tasks(int pid, std::vector<int>& tids);
+bool ParseTaskStat(int pid, int tid, ProcStatRecord& record);
+
+// Fields of /proc/[pid]/status used by the monitor
+struct ProcStatusRecord {
+  int uid{-1};    // real uid
+  long vmSwap{};  // VmSwap in kB
+};
+bool ParseProcStatus(int pid, ProcStatusRecord& record);
+bool ParseProcStatus(const char* data, std::size_t length,
+                     ProcStatusRecord& record);
+
+// /proc/[pid]/smaps_rollup, the sums over all mappings, in kB. The kernel
+// walks every page table of the process to produce it, so it is only
+// read for a few processes at a time.
+struct SmapsRollupRecord {
+  long rss{};
+  long pss{};
+  long shared{};   // Shared_Clean + Shared_Dirty
+  long private_{};  // Private_Clean + Private_Dirty
+  long swap{};
+};
+bool ParseSmapsRollup(int pid, SmapsRollupRecord& record);
+bool ParseSmapsRollup(const char* data, std::size_t length,
+                      SmapsRollupRecord& record);
+
+// /proc/[pid]/io, the I/O counters of the process since it started. The
+// bytes are what reached storage, not what the calls moved, which also
+// counts page cache hits and pipes.
+struct ProcIoRecord {
+  long long syscr{};  // read calls
+  long long syscw{};  // write calls
+  long long readBytes{};
+  long long writeBytes{};
+};
+bool ParseProcIo(int pid, ProcIoRecord& record);
+bool ParseProcIo(const char* data, std::size_t length, ProcIoRecord& record);
+
+// The cgroup v2 counters of one group, each read from its own file. A
+// file the group lacks, like memory.current of the root group, leaves its
+// fields at 0.
+struct CgroupRecord {
+  long long usageUsec{};      // cpu.stat
+  long long throttledUsec{};
+  long long memoryCurrent{};  // memory.current, bytes
+  long long anon{};           // memory.stat, bytes
+  long long file{};
+  long long readBytes{};      // io.stat, summed over the devices
+  long long writeBytes{};
+};
+bool ParseCgroupCpuStat(const char* data, std::size_t length,
+                        CgroupRecord& record);
+bool ParseCgroupMemoryStat(const char* data, std::size_t length,
+                           CgroupRecord& record);
+bool ParseCgroupIoStat(const char* data, std::size_t length,
+                       CgroupRecord& record);
+std::size_t ProcCgroup(int pid, char* buffer, std::size_t size);
+
+// Devices
+// One line of /proc/diskstats. The counters only grow, until they wrap.
+struct DiskRecord {
+  int major{};
+  int minor{};
+  std::string_view name{};  // into the parsed buffer
+  long long reads{};         // completed
+  long long readSectors{};   // of 512 bytes, whatever the device's size
+  long long writes{};
+  long long writeSectors{};
+  long long inFlight{};      // the only one that is not a counter
+  long long ioTicks{};       // ms the device was busy
+  long long weightedTicks{};  // ms spent by all requests, summed
+};
+const char* ParseDiskstatsLine(const char* p, const char* end,
+                               DiskRecord& record);
+
+// One interface line of /proc/net/dev
+struct NetRecord {
+  std::string_view name{};  // into the parsed buffer
+  long long rxBytes{};
+  long long rxPackets{};
+  long long rxDrops{};
+  long long txBytes{};
+  long long txPackets{};
+  long long txDrops{};
+};
+const char* ParseNetDevLine(const char* p, const char* end,
+                            NetRecord& record);
+
 std::string Command(int pid);
+std::size_t Command(int pid, char* buffer, std::size_t size);
 std::string Ram(int pid);
 std::string Uid(int pid);
 std::string User(int pid);
+std::string UserName(int uid);
 long int UpTime(int pid);
 };  // namespace LinuxParser
 
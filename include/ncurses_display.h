@@ -3,14 +3,34 @@
 
 #include <curses.h>
 
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "canvas.h"
+#include "collector.h"
+#include "frame.h"
+#include "history_ring.h"
 #include "process.h"
+#include "profiler.h"
 #include "system.h"
 
 namespace NCursesDisplay {
-void Display(System& system, int n = 10);
-void DisplaySystem(System& system, WINDOW* window);
-void DisplayProcesses(std::vector<Process>& processes, WINDOW* window, int n);
+void Display(System& system, int n = 10, HistoryRing* recorder = nullptr);
+void Replay(HistoryRing& history, int n = 10);
+void DisplaySystem(const Frame& frame, Canvas& canvas);
+void DisplayCores(const std::vector<float>& cores, Canvas& canvas, int row);
+void DisplayProcesses(const Frame& frame, Canvas& canvas, int n,
+                      int selected = -1);
+void DisplayGroups(const Frame& frame, Canvas& canvas, int n);
+void DisplayCgroups(const Frame& frame, Canvas& canvas, int n);
+void DisplayTree(const Frame& frame, Canvas& canvas, int n, int selected);
+void DisplayThreads(const Frame& frame, Canvas& canvas, int n);
+void DisplayProfile(const Profiler::Report& profile, Canvas& canvas);
+void DisplayDevices(const Frame& frame, Canvas& canvas);
+bool HandleKey(Collector& collector, int key);
 std::string ProgressBar(float percent);
+void ProgressBar(float percent, char* buffer, std::size_t size);
 };  // namespace NCursesDisplay
 
 #endif
\ No newline at end of file
@@ -0,0 +1,39 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <string>
+
+#include "frame_writer.h"
+
+// Command line settings of the monitor
+struct Options {
+  int threads{1};
+  bool netlink{false};
+  int top{10};  // processes shown or recorded per tick
+  std::string root;  // prefix of /proc and /etc, "" for the live system
+  Columns columns;  // row fields read from /proc
+  GroupBy groupBy{GroupBy::kNone};
+  bool tree{false};  // rows follow the process tree
+  bool threadView{false};  // shows the threads of the rows, or of threadPid
+  int threadPid{0};
+
+  // Headless collector
+  bool headless{false};
+  int intervalMs{1000};
+  long count{0};  // ticks to collect, 0 runs until killed
+  FrameWriter::Format format{FrameWriter::Format::kJsonLines};
+  std::string output{"-"};  // "-" is stdout
+  std::string profile;  // the monitor's own costs per tick, "" for none
+
+  // History ring file
+  std::string record;  // appends every frame when set
+  long recordSlots{0};  // frames kept, 0 is HistoryRing::kDefaultCapacity
+  std::string replay;  // plays a recording back instead of sampling
+};
+
+namespace CommandLine {
+bool Parse(int argc, char* argv[], Options& options);
+void Usage(const char* program);
+};  // namespace CommandLine
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef PARSE_UTIL_H
+#define PARSE_UTIL_H
+
+#include <cstddef>
+#include <cstring>
+
+/*
+Allocation free helpers for scanning /proc text in place.
+Every function takes the current position and the end of the buffer
+and returns the position just past whatever it consumed.
+*/
+namespace ParseUtil {
+inline bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\n'; }
+
+inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+inline const char* SkipSpaces(const char* p, const char* end) {
+  while (p < end && IsSpace(*p)) ++p;
+  return p;
+}
+
+// Skips the current whitespace separated token and the blanks after it
+inline const char* SkipToken(const char* p, const char* end) {
+  while (p < end && !IsSpace(*p)) ++p;
+  return SkipSpaces(p, end);
+}
+
+// Moves to the first character of the next line
+inline const char* SkipLine(const char* p, const char* end) {
+  const void* newline = std::memchr(p, '\n', end - p);
+  return newline ? static_cast<const char*>(newline) + 1 : end;
+}
+
+// True if the text at p starts with the NUL terminated prefix
+inline bool StartsWith(const char* p, const char* end, const char* prefix) {
+  std::size_t length = std::strlen(prefix);
+  return static_cast<std::size_t>(end - p) >= length &&
+         std::memcmp(p, prefix, length) == 0;
+}
+
+// Parses an optionally signed decimal integer after any leading blanks.
+// Without a digit nothing counts as consumed: it returns p itself and
+// sets out to 0, so a caller can tell a missing number from a 0.
+inline const char* ParseLong(const char* p, const char* end, long long& out) {
+  const char* start = p;
+  p = SkipSpaces(p, end);
+  bool negative{false};
+  if (p < end && *p == '-') {
+    negative = true;
+    ++p;
+  }
+  const char* digits = p;
+  long long value{0};
+  while (p < end && IsDigit(*p)) {
+    value = value * 10 + (*p - '0');
+    ++p;
+  }
+  out = negative ? -value : value;
+  return p == digits ? start : p;
+}
+
+// Parses a non negative decimal number with an optional fractional part
+inline const char* ParseDouble(const char* p, const char* end, double& out) {
+  long long whole{0};
+  p = ParseLong(SkipSpaces(p, end), end, whole);
+  double value = static_cast<double>(whole);
+  if (p < end && *p == '.') {
+    double scale{0.1};
+    for (++p; p < end && IsDigit(*p); ++p, scale *= 0.1) {
+      value += (*p - '0') * scale;
+    }
+  }
+  out = value;
+  return p;
+}
+};  // namespace ParseUtil
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef PROC_CONNECTOR_H
+#define PROC_CONNECTOR_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+/*
+Event driven process discovery through the kernel proc connector.
+A listener thread receives PROC_EVENT_FORK, EXEC and EXIT over netlink
+and keeps the set of live pids current, so a refresh does not have to
+walk /proc. Subscribing needs CAP_NET_ADMIN; Start() returns false
+without it and the caller keeps using LinuxParser::Pids().
+
+The set is rebuilt from a /proc directory scan on start, whenever the
+socket overflowed and events were lost, and every kReconcileInterval
+to catch anything missed in between.
+*/
+class ProcConnector {
+ public:
+  ProcConnector() = default;
+  ~ProcConnector();
+  ProcConnector(const ProcConnector&) = delete;
+  ProcConnector& operator=(const ProcConnector&) = delete;
+
+  bool Start();
+  void Pids(std::vector<int>& pids);
+
+  // Processes that were forked and exited again between the last two
+  // calls to Pids(), which a poll of /proc never sees
+  int ShortLived() const;
+
+ private:
+  void Listen();
+  void Handle(const void* data, std::size_t length);
+  void Reconcile();
+
+  int socket_{-1};
+  std::thread listener_ = {};
+  std::atomic<bool> stop_{false};
+
+  std::mutex mutex_;
+  std::unordered_set<int> live_ = {};
+  std::unordered_set<int> born_ = {};  // forked since the last Pids()
+  int shortLived_{0};
+  int shortLivedLast_{0};
+  bool overflowed_{false};
+  std::chrono::steady_clock::time_point reconciled_{};
+  std::vector<int> scan_ = {};
+};
+
+#endif
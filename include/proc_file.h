@@ -0,0 +1,42 @@
+#ifndef PROC_FILE_H
+#define PROC_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*
+A file that is opened once and then reread from offset 0 with pread()
+into a buffer that is reused between reads. /proc files regenerate their
+contents on every read, so this gives fresh data for one syscall instead
+of open, read and close each time.
+*/
+class ProcFile {
+ public:
+  ProcFile() = default;
+  explicit ProcFile(const std::string& filename);
+  ~ProcFile();
+  ProcFile(ProcFile&& other) noexcept;
+  ProcFile& operator=(ProcFile&& other) noexcept;
+  ProcFile(const ProcFile&) = delete;
+  ProcFile& operator=(const ProcFile&) = delete;
+
+  bool Open(const std::string& filename);
+  void Close();
+  bool IsOpen() const;
+  // True for the first failed Open() after one that succeeded, or after
+  // construction, so a file that stays missing is reported only once
+  bool FirstFailure();
+
+  // Rereads the file, returns the number of bytes now in Data(). A failed
+  // read closes the descriptor, e.g. once the process of a pid file exited.
+  std::size_t Read();
+  const char* Data() const;
+
+ private:
+  int fd_{-1};
+  bool failureReported_{false};
+  std::vector<char> buffer_ = {};
+};
+
+#endif
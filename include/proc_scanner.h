@@ -0,0 +1,100 @@
+#ifndef PROC_SCANNER_H
+#define PROC_SCANNER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "linux_parser.h"
+#include "proc_file.h"
+#include "profiler.h"
+
+// Everything read from /proc for one pid during a scan
+struct ProcSample {
+  bool ok{false};  // false if the process exited before it could be read
+  bool hasStatus{false};  // status is only read when asked for
+  bool withIo{false};     // io was asked for
+  bool hasIo{false};      // and could be read
+  LinuxParser::ProcStatRecord stat{};
+  LinuxParser::ProcStatusRecord status{};
+  LinuxParser::ProcIoRecord io{};
+};
+
+/*
+Reads /proc/[pid]/stat, and optionally status and io, for a pid list on
+a fixed pool of threads.
+The list is split into one contiguous range per worker. Workers claim
+small chunks of their own range and, once it is exhausted, steal chunks
+from the others, so a few slow pids do not leave the rest of the pool
+idle. Results go to the slot with the same index as the pid, so no two
+workers ever write to the same place and no locks are needed.
+With a single thread the scan runs serially on the calling thread.
+
+The files of pids passed to KeepOpen() stay open between scans and are
+reread with pread(), which pays off for the long-lived processes that
+stay in the displayed top rows.
+*/
+class ProcScanner {
+ public:
+  explicit ProcScanner(int threads = DefaultThreads());
+  ~ProcScanner();
+  ProcScanner(const ProcScanner&) = delete;
+  ProcScanner& operator=(const ProcScanner&) = delete;
+
+  void Scan(const std::vector<int>& pids, std::vector<ProcSample>& samples,
+            bool withStatus, bool withIo = false);
+  bool ReadStatus(int pid, LinuxParser::ProcStatusRecord& status);
+  bool ReadIo(int pid, LinuxParser::ProcIoRecord& io);
+  void KeepOpen(const std::vector<int>& pids);
+  int Threads() const;
+  std::chrono::nanoseconds LastScanTime() const;
+
+  static int DefaultThreads();
+
+ private:
+  // Cursor into the pid list owned by one worker, on its own cache line
+  struct alignas(64) Range {
+    std::atomic<std::size_t> next{0};
+    std::size_t end{0};
+  };
+
+  // Descriptors kept open for one pid
+  struct PidFiles {
+    ProcFile stat;
+    ProcFile status;
+    ProcFile io;  // closed if the process' counters may not be read
+  };
+
+  void Work(int worker);
+  void WorkerLoop(int worker);
+  void Read(int pid, ProcSample& sample);
+
+  int threads_{1};
+  std::vector<Range> ranges_;
+  std::vector<std::thread> workers_ = {};
+  // Only changed by KeepOpen() between scans, so workers can look it up
+  // without locking; each pid's files are used by one worker at a time
+  std::unordered_map<int, PidFiles> open_ = {};
+  std::vector<int> kept_ = {};  // the pids of the last KeepOpen(), sorted
+  const std::vector<int>* pids_{nullptr};
+  ProcSample* samples_{nullptr};
+  bool withStatus_{false};
+  bool withIo_{false};
+  Profiler::Counters* charge_{nullptr};  // of the thread that scans
+
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable done_;
+  unsigned long long job_{0};
+  int pending_{0};
+  bool stop_{false};
+
+  std::chrono::nanoseconds lastScanTime_{0};
+};
+
+#endif
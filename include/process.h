@@ -2,7 +2,12 @@
 #define PROCESS_H
 #include <unistd.h>
 
+#include <chrono>
 #include <string>
+#include <string_view>
+
+#include "linux_parser.h"
+#include "sort_key.h"
 
 /*
 Basic class for Process representation
@@ -10,23 +15,78 @@ It contains relevant attributes as shown below
 */
 class Process {
  public:
-    Process(int pid) {
-        this->pid = pid;
-        ramUtil = stoi(Ram());
-    }
+  using Clock = std::chrono::steady_clock;
+
+  Process(int pid) { this->pid = pid; }
 
   int Pid();                               // TODO: See src/process.cpp
   std::string User();                      // TODO: See src/process.cpp
   std::string Command();                   // TODO: See src/process.cpp
   float CpuUtilization();                  // TODO: See src/process.cpp
   std::string Ram();                       // TODO: See src/process.cpp
+  long RamMb() const;  // resident set
+  // Memory details of the mappings, -1 when they could not be read
+  long PssMb() const;
+  long SharedMb() const;
+  long PrivateMb() const;
+  long SwapMb() const;
+  // Rates of the io counters since they were last read, -1 until they
+  // were read twice or when they may not be read
+  long ReadKbPerSecond() const;
+  long WriteKbPerSecond() const;
+  float ReadCallsPerSecond() const;
+  float WriteCallsPerSecond() const;
+  double IoBytesPerSecond() const;  // read and written
   long int UpTime();                       // TODO: See src/process.cpp
   bool operator<(Process const& a) const;  // TODO: See src/process.cpp
+  bool Precedes(Process const& a, SortKey key) const;
+
+  unsigned long long StartTime() const { return stat.startTime; }
+  long Threads() const { return stat.numThreads; }
+  void Update(const LinuxParser::ProcStatRecord& record, Clock::time_point now,
+              double systemUpTime);
+  void UpdateStatus(const LinuxParser::ProcStatusRecord& status);
+  bool SmapsExpired(Clock::time_point now) const { return now >= smapsExpiry; }
+  void UpdateSmaps(const LinuxParser::SmapsRollupRecord* record,
+                   Clock::time_point expiry);
+  void UpdateIo(const LinuxParser::ProcIoRecord* record,
+                Clock::time_point now);
+
+  // Fields that do not change while the process runs, kept in strings
+  // interned by System. The command is dropped again on exec().
+  bool HasCommand() const { return hasCommand; }
+  void SetCommand(std::string_view text);
+  std::string_view CachedCommand() const { return command; }
+  bool HasUser() const { return uid >= 0 && userUid == uid; }
+  int Uid() const { return uid; }
+  void SetUser(std::string_view name);
+  void ClearUser();
+  std::string_view CachedUser() const { return user; }
 
   // TODO: Declare any necessary private members
  private:
      int pid;
-     int ramUtil;
+     int uid{-1};
+     long swapKb{-1};  // from status, refreshed with the row
+     LinuxParser::SmapsRollupRecord smaps{};  // valid if hasSmaps
+     bool hasSmaps{false};
+     Clock::time_point smapsExpiry{};
+     LinuxParser::ProcIoRecord io{};  // valid if hasIo
+     bool hasIo{false};
+     Clock::time_point ioTime{};
+     double readBytesPerSecond{-1};
+     double writeBytesPerSecond{-1};
+     float readCallsPerSecond{-1};
+     float writeCallsPerSecond{-1};
+     LinuxParser::ProcStatRecord stat{};
+     long prevTicks{-1};  // utime + stime of the previous sample
+     Clock::time_point prevTime{};
+     float cpuUtil{};
+     long upTime{};
+     bool hasCommand{false};
+     std::string_view command{};
+     int userUid{-1};  // the uid user was resolved for
+     std::string_view user{};
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,105 @@
+#ifndef PROCESS_TABLE_H
+#define PROCESS_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "group_by.h"
+#include "proc_scanner.h"
+#include "process.h"
+#include "process_tree.h"
+#include "sort_key.h"
+#include "string_pool.h"
+
+// The numeric fields of the table, one contiguous array per field, all
+// indexed like ProcessTable::Entries()
+struct ProcessColumns {
+  std::vector<int> pid = {};
+  std::vector<int> ppid = {};
+  std::vector<int> uid = {};             // -1 until status was read
+  std::vector<std::uint32_t> user = {};  // dense id of uid, 0 is unknown
+  std::vector<std::uint32_t> name = {};  // comm, an id of Names()
+  std::vector<std::uint32_t> cgroup = {};  // a CgroupTable id, 0 unknown
+  std::vector<long long> ticks = {};     // utime + stime
+  std::vector<float> cpu = {};           // fraction of one core
+  std::vector<long long> rssKb = {};
+  std::vector<float> io = {};  // bytes read and written per second, or -1
+  std::vector<unsigned long long> startTime = {};
+};
+
+// Sums over the processes of one group; id is a user, name or cgroup id
+struct ProcessGroup {
+  std::uint32_t id{};
+  int processes{};
+  float cpu{};
+  long long rssKb{};
+};
+
+/*
+Persistent table of the processes currently alive. Entries are identified
+by pid plus start time, so a recycled pid shows up as a new process.
+Update() diffs the new pid list against the table: existing entries are
+sampled in place and keep their previous CPU ticks, vanished ones are
+retired and only new pids get a fresh entry. Resample() only refreshes
+entries already in the table, for a subset of the pids, and leaves
+finding new and exited processes to the next Update().
+
+Next to the Process entries, which hold what is shown of a row, the
+fields that are sorted and summed over every process are kept as
+ProcessColumns, so Top() and Aggregate() stream through flat arrays
+instead of chasing through hundreds of thousands of objects. The
+parent links are kept as a ProcessTree, changed only where a process
+started, exited or was reparented. Command names are counted by the
+entries that have them, and a name no entry has any more is released
+from the pool, so Names() ids, and the sums of Aggregate(), stay at the
+names of the processes alive.
+*/
+class ProcessTable {
+ public:
+  void Update(const std::vector<int>& pids,
+              const std::vector<ProcSample>& samples, double systemUpTime);
+  void Resample(const std::vector<int>& pids,
+                const std::vector<ProcSample>& samples, double systemUpTime);
+  std::vector<Process>& Entries();
+  const ProcessColumns& Columns() const;
+  Process* Find(int pid);
+  ProcessTree& Tree();
+
+  void Top(SortKey key, std::size_t n, std::vector<std::size_t>& top) const;
+  void Aggregate(GroupBy by, std::vector<ProcessGroup>& groups);
+  void SetCgroup(std::size_t index, std::uint32_t cgroup);
+  int UserUid(std::uint32_t user) const;
+  std::string_view Name(std::uint32_t name) const;
+
+ private:
+  void Store(std::size_t slot, const ProcSample& sample);
+  void Retire(std::size_t slot);
+  std::uint32_t NameId(std::string_view comm);
+  void DropName(std::uint32_t name);
+  std::uint32_t UserId(int uid);
+
+  std::vector<Process> entries_ = {};
+  ProcessColumns columns_ = {};
+  std::vector<unsigned> seen_ = {};  // generation an entry was last seen in
+  std::unordered_map<int, std::size_t> slots_ = {};  // pid -> entries_ index
+  unsigned generation_{};
+  ProcessTree tree_ = {};
+  std::vector<ProcessTree::Node> nodes_ = {};  // tree_ node of an entry
+
+  StringPool names_ = {};
+  std::vector<std::uint32_t> nameEntries_ = {};  // entries per name id
+  std::unordered_map<int, std::uint32_t> userIds_ = {};  // uid -> user id
+  std::vector<int> uids_ = {-1};  // user id -> uid
+  std::size_t cgroups_{1};  // above the largest cgroup id set
+
+  static constexpr std::size_t kLanes{4};  // partial sums per group
+
+  // Sums per group id and lane, reused by Aggregate()
+  std::vector<int> groupProcesses_ = {};
+  std::vector<float> groupCpu_ = {};
+  std::vector<long long> groupRssKb_ = {};
+};
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef PROCESS_TREE_H
+#define PROCESS_TREE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "sort_key.h"
+
+// One visible line of the flattened tree, in display order
+struct TreeLine {
+  int pid{};
+  int depth{};  // 0 for the processes without a parent in the table
+  bool children{};
+  bool collapsed{};
+  int processes{};  // in the subtree, the process itself included
+  float cpu{};      // subtree sums
+  long long rssKb{};
+};
+
+/*
+The parent and child links of the processes in a ProcessTable, built from
+the ppid field of stat. Nodes are added and removed one at a time as
+processes start and exit, and moved when a process is reparented, so the
+tree is never rebuilt as a whole.
+
+Each node keeps the sums of its subtree. A change to a process only marks
+the node and its ancestors dirty, and Rollup() adds up again only the
+dirty nodes, from the values their clean children already hold. A hidden
+root node is the parent of every process whose parent is not in the
+table, and its sums are those of the whole table.
+*/
+class ProcessTree {
+ public:
+  using Node = std::uint32_t;
+  static constexpr Node kNone{UINT32_MAX};
+
+  ProcessTree();
+  Node Add(int pid, int ppid, unsigned long long startTime);
+  void Remove(Node node);
+  void Update(Node node, int ppid, float cpu, long long rssKb);
+  void Toggle(int pid);  // collapses or expands the subtree of pid
+  std::size_t Flatten(SortKey key, std::size_t offset, std::size_t n,
+                      std::vector<TreeLine>& lines);
+
+ private:
+  static constexpr Node kRoot{0};
+
+  struct Entry {
+    int pid{};
+    int ppid{};
+    unsigned long long startTime{};
+    Node parent{kNone};
+    Node first{kNone};  // first child
+    Node next{kNone};   // siblings
+    Node previous{kNone};
+    float cpu{};
+    long long rssKb{};
+    // Subtree sums, valid while not dirty
+    float subtreeCpu{};
+    long long subtreeRssKb{};
+    int processes{};
+    int visible{};  // lines the subtree takes up when flattened
+    int children{};
+    bool collapsed{false};
+    bool dirty{true};
+  };
+
+  void Link(Node node, Node parent);
+  void Unlink(Node node);
+  void Reparent(Node node, int ppid);
+  void MarkDirty(Node node);
+  void Rollup(Node node);
+  void Children(Node node, SortKey key, std::size_t k,
+                std::vector<Node>& children) const;
+  void Flatten(Node node, SortKey key, int depth, std::size_t& skip,
+               std::size_t n, std::vector<TreeLine>& lines);
+
+  std::vector<Entry> nodes_ = {};
+  std::vector<Node> free_ = {};
+  std::unordered_map<int, Node> pids_ = {};  // pid -> node
+  std::vector<std::vector<Node>> children_ = {};  // per depth, sorted
+};
+
+#endif
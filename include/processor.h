@@ -2,12 +2,31 @@
 #define PROCESSOR_H
 #include <vector>
 
+#include "system_snapshot.h"
+
+/*
+CPU utilization over the interval between the last two snapshots,
+for the whole machine and for every core
+*/
 class Processor {
  public:
+  void Update(const SystemSnapshot& snapshot);
   float Utilization();  // TODO: See src/processor.cpp
+  int CoreCount() const;
+  float CoreUtilization(int core) const;
 
   // TODO: Declare any necessary private members
  private:
+  struct Sample {
+    long long active{};
+    long long total{};
+    float utilization{};
+  };
+  static void Advance(Sample& sample, const SystemSnapshot::CpuTimes& times);
+
+  Sample aggregate_ = {};
+  std::vector<Sample> cores_ = {};  // reused every tick
+  int coreCount_{};
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,127 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*
+What the monitor's own refresh cycle costs, per phase. A Scope adds the
+time, allocations and system calls spent while it lives to its phase,
+EndTick() closes the tick, and the last kWindow ticks are kept to report
+the last, median and 99th percentile value of each.
+
+Allocations are counted by the global operator new. System calls are
+counted where the monitor issues them, in the /proc read helpers; calls
+made inside libc (directory listing, NSS) are not included. Both are
+counted per thread, so a Scope only sees what its own thread does, and
+what a pool thread does on its behalf under a ChargeTo. The proc
+connector's thread, and the collector and renderer of the live view,
+never count into each other's phases.
+*/
+class Profiler {
+ public:
+  enum class Phase {
+    kTick,      // everything below, once per refresh
+    kSnapshot,  // system wide /proc files
+    kPids,      // process discovery
+    kScan,      // per process reads
+    kSort,      // top n selection
+    kStatus,    // status files of the rows shown
+    kSmaps,     // smaps_rollup of the rows shown, when expired
+    kUsers,     // uid to name lookups
+    kCgroups,   // cgroup counters and the cgroups of new processes
+    kThreads,   // task stat files, in thread view
+    kOutput,    // headless writes, or the live view's drawing
+    kCount
+  };
+  enum class Counter { kTime, kAllocations, kSyscalls, kCount };  // ns
+
+  struct Summary {
+    long long last;
+    long long p50;
+    long long p99;
+  };
+
+  static constexpr std::size_t kWindow{120};  // two minutes at 1 Hz
+  static constexpr int kPhases{static_cast<int>(Phase::kCount)};
+  static constexpr int kCounters{static_cast<int>(Counter::kCount)};
+
+  // Every Summary at once, to hand to another thread
+  struct Report {
+    std::size_t ticks{};
+    std::array<std::array<Summary, kCounters>, kPhases> values{};
+  };
+
+  // What the threads charging them have allocated and called so far,
+  // zero as thread storage
+  struct Counters {
+    std::atomic<long long> allocations;
+    std::atomic<long long> syscalls;
+  };
+
+  // While it lives, the calling thread's allocations and system calls
+  // count for counters, those of the thread it works for
+  class ChargeTo {
+   public:
+    explicit ChargeTo(Counters* counters);
+    ~ChargeTo();
+    ChargeTo(const ChargeTo&) = delete;
+    ChargeTo& operator=(const ChargeTo&) = delete;
+
+   private:
+    Counters* previous_;
+  };
+
+  class Scope {
+   public:
+    Scope(Profiler& profiler, Phase phase);
+    ~Scope();
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    Profiler& profiler_;
+    Phase phase_;
+    std::chrono::steady_clock::time_point start_;
+    long long allocations_;
+    long long syscalls_;
+  };
+
+  // The counters the calling thread charges, its own unless under a
+  // ChargeTo
+  static Counters* ThreadCounters() {
+    return charged_ != nullptr ? charged_ : &own_;
+  }
+  static void CountAllocation() {
+    ThreadCounters()->allocations.fetch_add(1, std::memory_order_relaxed);
+  }
+  static void CountSyscalls(long long count = 1) {
+    ThreadCounters()->syscalls.fetch_add(count, std::memory_order_relaxed);
+  }
+  static long long Allocations();
+  static long long Syscalls();
+  static const char* Name(Phase phase);
+
+  void EndTick();
+  std::size_t Ticks() const;  // ticks in the window
+  Summary Get(Phase phase, Counter counter) const;
+  void Get(Report& report) const;
+  void AppendJson(std::string& out) const;
+
+ private:
+  using Tick = std::array<std::array<long long, kCounters>, kPhases>;
+
+  static inline thread_local Counters own_{};
+  static inline thread_local Counters* charged_{nullptr};
+
+  Tick current_{};
+  std::vector<Tick> window_ = std::vector<Tick>(kWindow);
+  std::size_t ticks_{0};  // ever ended
+  mutable std::vector<long long> scratch_ = {};
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <array>
+#include <chrono>
+
+/*
+When each part of the live view is due for a refresh. The system wide
+counters are cheap and refreshed often, the rows on screen once a second
+and the full pid scan, which finds new and exited processes, least often.
+The scan interval follows what the last scan cost, so on a machine with
+many processes scanning never takes more than 1/kScanShare of the time.
+*/
+class Scheduler {
+ public:
+  using Clock = std::chrono::steady_clock;
+  enum class Tier { kSystem, kRows, kScan, kCount };
+
+  static constexpr Clock::duration kSystemInterval{
+      std::chrono::milliseconds(250)};
+  static constexpr Clock::duration kRowsInterval{std::chrono::seconds(1)};
+  static constexpr Clock::duration kMinScanInterval{std::chrono::seconds(2)};
+  static constexpr Clock::duration kMaxScanInterval{std::chrono::seconds(30)};
+  static constexpr int kScanShare{50};
+
+  bool Due(Tier tier, Clock::time_point now) const;
+  void Done(Tier tier, Clock::time_point now, Clock::duration cost);
+  void Expedite(Tier tier);  // due right away, like after a key press
+  Clock::duration Interval(Tier tier) const;
+  Clock::time_point Next() const;  // when the next tier is due
+
+ private:
+  static constexpr int kTiers{static_cast<int>(Tier::kCount)};
+
+  std::array<Clock::duration, kTiers> intervals_ = {
+      kSystemInterval, kRowsInterval, kMinScanInterval};
+  std::array<Clock::time_point, kTiers> due_ = {};  // all due at first
+};
+
+#endif
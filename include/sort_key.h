@@ -0,0 +1,7 @@
+#ifndef SORT_KEY_H
+#define SORT_KEY_H
+
+// Columns the process list can be ordered by
+enum class SortKey { kCpu, kMemory, kUpTime, kPid, kIo };
+
+#endif
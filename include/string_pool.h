@@ -0,0 +1,40 @@
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/*
+Keeps one copy of every distinct string passed to Intern() and returns a
+view of it that stays valid for the life of the pool. Interning a string
+that is already pooled does not allocate, so fields that repeat across
+processes and ticks, like command and user names, cost one allocation
+the first time they are seen and none after.
+
+Id() interns as well and numbers the strings densely from 0 in the order
+they were first seen, for use as an array index. Release() gives up the
+string of an id, and its view, once nothing refers to it any more; the
+next new string takes the id over, so Size() stays bounded by the
+strings in use at once rather than all ever seen.
+*/
+class StringPool {
+ public:
+  std::string_view Intern(std::string_view text);
+  std::uint32_t Id(std::string_view text);
+  std::string_view Get(std::uint32_t id) const;
+  void Release(std::uint32_t id);
+  std::size_t Size() const;  // above the largest id in use
+
+ private:
+  std::deque<std::string> strings_ = {};  // never moves its elements
+  std::vector<std::uint32_t> free_ = {};  // released ids, to hand out again
+  // views of strings_ -> their index
+  std::unordered_map<std::string_view, std::uint32_t> index_ = {};
+};
+
+#endif
@@ -1,27 +1,137 @@
 #ifndef SYSTEM_H
 #define SYSTEM_H
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "cgroup_table.h"
+#include "device_stats.h"
+#include "frame.h"
+#include "proc_connector.h"
+#include "proc_scanner.h"
 #include "process.h"
+#include "process_table.h"
 #include "processor.h"
+#include "profiler.h"
+#include "scheduler.h"
+#include "string_pool.h"
+#include "system_snapshot.h"
+#include "thread_table.h"
+#include "triple_buffer.h"
+
+// What a renderer reads: one complete refresh and the profile at its time
+struct Snapshot {
+  unsigned long long sequence{};  // 0 until the first is published
+  Frame frame;
+  Profiler::Report profile;
+};
 
 class System {
  public:
+  explicit System(int scanThreads = ProcScanner::DefaultThreads());
+  bool UseProcConnector();
+  void Refresh();
+  void Collect(Frame& frame, std::size_t n);
+  bool RefreshDue(Scheduler& scheduler, Scheduler::Clock::time_point now,
+                  std::size_t n);
+  void CollectSystem(Frame& frame);
+  void CollectProcesses(Frame& frame);
+  Snapshot& Back();
+  void Publish();
+  const Snapshot& Latest();
   Processor& Cpu();                   // TODO: See src/system.cpp
-  std::vector<Process>& Processes();  // TODO: See src/system.cpp
+  void ScanProcesses();
+  bool RefreshRows();
+  std::size_t Rank(std::size_t n);  // the number of rows
+  SortKey GetSortKey() const;
+  void SetSortKey(SortKey key);
+  void SetColumns(const Columns& columns);
+  GroupBy GetGroupBy() const;
+  void SetGroupBy(GroupBy by);
+  bool GetTreeView() const;
+  void SetTreeView(bool tree);
+  std::size_t GetTreeOffset() const;
+  void SetTreeOffset(std::size_t offset);
+  void ToggleCollapsed(int pid);
+  bool GetThreadView() const;
+  void SetThreadView(bool threads);
+  int GetThreadPid() const;
+  void SetThreadPid(int pid);
+  Profiler& GetProfiler();
   float MemoryUtilization();          // TODO: See src/system.cpp
   long UpTime();                      // TODO: See src/system.cpp
+  double LoadAverage(int period);     // 0, 1, 2 = 1, 5, 15 minutes
   int TotalProcesses();               // TODO: See src/system.cpp
   int RunningProcesses();             // TODO: See src/system.cpp
+  int ShortLivedProcesses();
   std::string Kernel();               // TODO: See src/system.cpp
   std::string OperatingSystem();      // TODO: See src/system.cpp
 
   // TODO: Define any necessary private members
  private:
+  static constexpr std::chrono::seconds kMinSmapsTtl{5};
+  static constexpr std::chrono::seconds kMaxSmapsTtl{60};
+  static constexpr int kSmapsCostShare{100};
+  static constexpr std::size_t kMinCompactStrings{1024};
+
+  void CollectDevices(Frame& frame);
+  void CollectGroups(Frame& frame);
+  void CollectCgroups(Frame& frame);
+  void CollectTree(Frame& frame);
+  void CollectThreads(Frame& frame);
+  void RankTree(std::size_t n);
+  void RankGroups();
+  void RankCgroups(std::size_t n);
+  void RankThreads();
+  bool SortsByIo() const;
+  void ReadCgroups();
+  void ReadRows();
+  void ReadSmaps();
+  void ReadThreads();
+  void CompactStrings();
+
+  Profiler profiler_ = {};
   Processor cpu_ = {};
-  std::vector<Process> processes_ = {};
+  SystemSnapshot snapshot_ = {};
+  DeviceStats devices_ = {};
+  std::vector<std::size_t> diskOrder_ = {};  // devices_ indices, sorted
+  std::vector<std::size_t> netOrder_ = {};
+  ProcScanner scanner_;
+  std::unique_ptr<ProcConnector> connector_ = {};
+  std::vector<int> pids_ = {};
+  std::vector<ProcSample> samples_ = {};  // samples_[i] belongs to pids_[i]
+  ProcessTable table_ = {};
+  std::vector<Process*> processes_ = {};  // top table_ entries, sorted
+  std::vector<std::size_t> top_ = {};  // table_ indices of processes_
+  std::vector<ProcessGroup> groups_ = {};
+  CgroupTable cgroups_ = {};
+  bool cgroupsFound_{false};  // a cgroup v2 hierarchy is mounted
+  std::vector<int> cgroupProcesses_ = {};  // by cgroup id
+  std::vector<std::size_t> cgroupOrder_ = {};  // cgroups_ indices, sorted
+  std::vector<int> topPids_ = {};
+  std::vector<ProcSample> topSamples_ = {};  // for topPids_
+  SortKey sortKey_{SortKey::kMemory};
+  Columns columns_ = {};
+  GroupBy groupBy_{GroupBy::kNone};
+  bool treeView_{false};
+  std::size_t treeOffset_{0};  // as asked for
+  std::size_t treeShown_{0};   // cut to what the tree holds
+  std::size_t treeSize_{0};
+  std::vector<TreeLine> treeLines_ = {};  // of processes_, in tree view
+  bool threadView_{false};
+  int threadPid_{0};  // whose threads are read, 0 for those of the rows
+  ThreadTable threads_ = {};
+  std::vector<Process*> threadProcesses_ = {};
+  std::vector<std::size_t> threadOrder_ = {};  // threads_ indices, sorted
+  StringPool strings_ = {};  // commands and user names of rows shown
+  std::size_t keptStrings_{0};  // in strings_ after CompactStrings()
+  std::string os_ = {};
+  std::string kernel_ = {};
+  TripleBuffer<Snapshot> snapshots_ = {};
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,59 @@
+#ifndef SYSTEM_SNAPSHOT_H
+#define SYSTEM_SNAPSHOT_H
+
+#include <string>
+#include <vector>
+
+#include "linux_parser.h"
+#include "proc_file.h"
+
+/*
+System wide counters taken from /proc/stat, /proc/meminfo, /proc/uptime
+and /proc/loadavg. The files stay open; Refresh() rereads each of them
+exactly once per tick into reused buffers and picks out only the lines
+the monitor displays.
+*/
+class SystemSnapshot {
+ public:
+  // One cpu line of /proc/stat, jiffies indexed by LinuxParser::CPUStates
+  struct CpuTimes {
+    long long jiffies[LinuxParser::kGuestNice_ + 1]{};
+  };
+
+  SystemSnapshot();
+  bool Refresh();
+
+  // /proc/stat
+  CpuTimes cpu{};
+  std::vector<CpuTimes> cores = {};  // indexed by the N of "cpuN"
+  int coreCount{};
+  int totalProcesses{};
+  int runningProcesses{};
+
+  // /proc/meminfo, in kB
+  long long memTotal{};
+  long long memFree{};
+  long long buffers{};
+  long long cached{};
+
+  // /proc/uptime, in seconds
+  double upTime{};
+  double idleTime{};
+
+  // /proc/loadavg, over 1, 5 and 15 minutes
+  double loadAverage[3]{};
+
+ private:
+  static std::size_t Read(ProcFile& file, const std::string& filename);
+  bool ParseStat();
+  bool ParseMeminfo();
+  bool ParseUptime();
+  bool ParseLoadavg();
+
+  ProcFile stat_ = {};
+  ProcFile meminfo_ = {};
+  ProcFile uptime_ = {};
+  ProcFile loadavg_ = {};
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef THREAD_TABLE_H
+#define THREAD_TABLE_H
+
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+
+#include "process.h"
+
+// One thread of a process and its CPU use over the last interval
+struct Thread {
+  int pid{};
+  int tid{};
+  char state{};
+  int processor{};  // CPU it last ran on
+  float cpu{};      // fraction of one core
+  char name[16]{};  // comm of the thread
+};
+
+/*
+The threads of a few processes, from /proc/[pid]/task. Listing and
+reading every thread of a host costs as many times a scan of its
+processes as there are threads per process, so Read() only looks at the
+processes it is given, which System keeps to the rows shown or to one
+process picked by the user. A process with a single thread, which most
+are, is read without listing its task directory.
+
+CPU use is measured like that of a Process, from the ticks since the
+previous Read() that saw the thread, or over its lifetime the first
+time. A tid reused by a new thread is told apart by the start time.
+*/
+class ThreadTable {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  void Read(const std::vector<Process*>& processes, double systemUpTime);
+  const std::vector<Thread>& Threads() const;
+
+ private:
+  struct Sample {
+    long long ticks{};  // utime + stime
+    unsigned long long startTime{};
+    Clock::time_point time{};
+    unsigned generation{};  // of the last Read() that saw the thread
+  };
+
+  std::vector<Thread> threads_ = {};  // of the last Read(), by process
+  std::unordered_map<int, Sample> samples_ = {};  // by tid
+  std::vector<int> tids_ = {};
+  unsigned generation_{};
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <array>
+#include <atomic>
+
+/*
+Hands values from one writer thread to one reader thread without locks.
+The writer fills Back() and publishes it; Update() moves the reader to
+the newest published value, if there is one, and Front() is the value
+the reader is on. Each side owns one of the three buffers and the third
+is the one in the middle, so neither side ever waits for the other, and
+the reader's value stays untouched until it calls Update() again.
+*/
+template <typename T>
+class TripleBuffer {
+ public:
+  T& Back() { return buffers_[back_]; }
+
+  void Publish() {
+    unsigned previous =
+        middle_.exchange(back_ | kFresh, std::memory_order_acq_rel);
+    back_ = previous & kIndex;
+  }
+
+  // Returns false, and keeps the current value, if nothing was published
+  bool Update() {
+    if ((middle_.load(std::memory_order_relaxed) & kFresh) == 0) {
+      return false;
+    }
+    unsigned previous = middle_.exchange(front_, std::memory_order_acq_rel);
+    front_ = previous & kIndex;
+    return true;
+  }
+
+  const T& Front() const { return buffers_[front_]; }
+
+ private:
+  static constexpr unsigned kIndex{3};
+  static constexpr unsigned kFresh{4};  // published, not yet taken
+
+  std::array<T, 3> buffers_ = {};
+  alignas(64) std::atomic<unsigned> middle_{1};
+  alignas(64) unsigned back_{0};   // writer only
+  alignas(64) unsigned front_{2};  // reader only
+};
+
+#endif
@@ -0,0 +1,91 @@
+#include "../include/canvas.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+
+Canvas::Canvas(WINDOW* window)
+    : window_(window),
+      width_(getmaxx(window)),
+      height_(getmaxy(window)),
+      text_(static_cast<std::size_t>(width_ * height_), ' '),
+      attrs_(text_.size(), A_NORMAL) {}
+
+WINDOW* Canvas::Window() const { return window_; }
+
+int Canvas::Width() const { return width_; }
+
+int Canvas::Height() const { return height_; }
+
+// Builds the padded field in line_, then writes it only if it differs
+// from the cells already there
+void Canvas::Put(int y, int x, int width, const char* text, attr_t attr) {
+  int end{std::min({x + width, width_ - 1,
+                    x + static_cast<int>(sizeof(line_)) - 1})};
+  if (y < 0 || y >= height_ || x < 0 || x >= end) {
+    return;
+  }
+  int length{end - x};
+  bool same{true};
+  bool ended{false};
+  std::size_t cell{static_cast<std::size_t>(y * width_ + x)};
+  for (int i{0}; i < length; ++i, ++cell) {
+    char c{ended ? '\0' : text[i]};
+    if (c == '\0') {
+      ended = true;
+      c = ' ';
+    } else if (static_cast<unsigned char>(c) < ' ' || c == '\x7f') {
+      c = '?';
+    }
+    line_[i] = c;
+    same = same && text_[cell] == c && attrs_[cell] == attr;
+  }
+  if (same) {
+    return;
+  }
+
+  std::copy(line_, line_ + length, text_.begin() + (y * width_ + x));
+  std::fill_n(attrs_.begin() + (y * width_ + x), length, attr);
+  wattrset(window_, attr);
+  mvwaddnstr(window_, y, x, line_, length);
+  wattrset(window_, A_NORMAL);
+  dirty_ = true;
+}
+
+void Canvas::Printf(int y, int x, int width, attr_t attr, const char* format,
+                    ...) {
+  char text[sizeof(line_)];
+  va_list arguments;
+  va_start(arguments, format);
+  std::vsnprintf(text, sizeof(text), format, arguments);
+  va_end(arguments);
+  Put(y, x, width, text, attr);
+}
+
+// The border covers whatever titles were put on it, so those cells are
+// forgotten and the next Put() there writes again
+void Canvas::Box() {
+  if (!boxed_) {
+    box(window_, 0, 0);
+    for (int x{0}; x < width_; ++x) {
+      text_[x] = '\0';
+      text_[(height_ - 1) * width_ + x] = '\0';
+    }
+    boxed_ = true;
+    dirty_ = true;
+  }
+}
+
+// The window still holds every cell, curses only has to send them again
+void Canvas::Touch() {
+  touchwin(window_);
+  boxed_ = false;
+  dirty_ = true;
+}
+
+void Canvas::Flush() {
+  if (dirty_) {
+    wnoutrefresh(window_);
+    dirty_ = false;
+  }
+}
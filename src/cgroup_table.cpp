@@ -0,0 +1,195 @@
+#include "../include/cgroup_table.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "../include/parse_util.h"
+#include "../include/profiler.h"
+
+using std::size_t;
+using std::string;
+
+CgroupTable::CgroupTable() { paths_.Id(""); }
+
+// Returns false, and finds nothing, without a cgroup v2 hierarchy
+bool CgroupTable::Scan() {
+  if (!FindMount()) {
+    return false;
+  }
+  ++generation_;
+  path_ = mount_;
+  Walk();
+
+  // Drop groups that were removed by moving the last group into their
+  // slot, and let new groups have their ids
+  for (size_t i{0}; i < groups_.size();) {
+    if (seen_[i] == generation_) {
+      ++i;
+      continue;
+    }
+    slots_.erase(groups_[i].path);
+    paths_.Release(groups_[i].path);
+    if (i != groups_.size() - 1) {
+      groups_[i] = groups_.back();
+      seen_[i] = seen_.back();
+      slots_[groups_[i].path] = i;
+    }
+    groups_.pop_back();
+    seen_.pop_back();
+  }
+  return true;
+}
+
+// Rates are over the time since the group was last read; a group read
+// for the first time, or whose counters went back because it was
+// recreated, has rates of 0
+void CgroupTable::Refresh() {
+  auto now = std::chrono::steady_clock::now();
+  for (Cgroup& group : groups_) {
+    std::string_view path{paths_.Get(group.path)};
+    path_.assign(mount_);
+    if (path != "/") {
+      path_.append(path);
+    }
+    LinuxParser::CgroupRecord record;
+    size_t length{Read("cpu.stat")};
+    LinuxParser::ParseCgroupCpuStat(buffer_.data(), length, record);
+    length = Read("memory.current");
+    ParseUtil::ParseLong(buffer_.data(), buffer_.data() + length,
+                         record.memoryCurrent);
+    length = Read("memory.stat");
+    LinuxParser::ParseCgroupMemoryStat(buffer_.data(), length, record);
+    length = Read("io.stat");
+    LinuxParser::ParseCgroupIoStat(buffer_.data(), length, record);
+
+    const LinuxParser::CgroupRecord& last = group.counters;
+    double seconds{
+        std::chrono::duration<double>(now - group.sampled).count()};
+    if (group.sampled != std::chrono::steady_clock::time_point{} &&
+        seconds > 0) {
+      auto rate = [seconds](long long now, long long before) {
+        return std::max(0LL, now - before) / seconds;
+      };
+      group.cpu = static_cast<float>(
+          rate(record.usageUsec, last.usageUsec) / 1e6);
+      group.throttled = static_cast<float>(
+          rate(record.throttledUsec, last.throttledUsec) / 1e6);
+      group.readBytesPerSecond = rate(record.readBytes, last.readBytes);
+      group.writeBytesPerSecond = rate(record.writeBytes, last.writeBytes);
+    }
+    group.counters = record;
+    group.sampled = now;
+  }
+}
+
+const std::vector<Cgroup>& CgroupTable::Groups() const { return groups_; }
+
+// A group found this way is read like those the walk found, and dropped
+// by the next Scan() that does not find it
+std::uint32_t CgroupTable::Id(std::string_view path) {
+  return path.empty() ? 0 : groups_[Slot(path)].path;
+}
+
+// False once the group of id was dropped; the id may then belong to
+// another group
+bool CgroupTable::Known(std::uint32_t id) const {
+  return id != 0 && slots_.count(id) != 0;
+}
+
+std::string_view CgroupTable::Path(std::uint32_t id) const {
+  return paths_.Get(id);
+}
+
+size_t CgroupTable::Paths() const { return paths_.Size(); }
+
+// The v2 hierarchy is mounted at the cgroup directory itself, or on hybrid
+// hosts at its unified subdirectory. Its root has cgroup.controllers,
+// which no v1 hierarchy has.
+bool CgroupTable::FindMount() {
+  if (!mount_.empty()) {
+    return true;
+  }
+  for (const char* below : {"", "/unified"}) {
+    string directory{LinuxParser::CgroupDirectory() + below};
+    Profiler::CountSyscalls();
+    if (access((directory + "/cgroup.controllers").c_str(), F_OK) == 0) {
+      mount_ = directory;
+      return true;
+    }
+  }
+  return false;
+}
+
+// The index in groups_ of the group of path, added if it is new, and
+// seen in this generation
+size_t CgroupTable::Slot(std::string_view path) {
+  std::uint32_t id{paths_.Id(path)};
+  auto slot = slots_.find(id);
+  if (slot == slots_.end()) {
+    slot = slots_.emplace(id, groups_.size()).first;
+    groups_.push_back(Cgroup{id});
+    seen_.push_back(0);
+  }
+  seen_[slot->second] = generation_;
+  return slot->second;
+}
+
+// Marks the group of path_ seen, then walks its subdirectories, each a
+// group of its own. path_ is the same again on return.
+void CgroupTable::Walk() {
+  std::string_view relative{path_};
+  relative.remove_prefix(mount_.size());
+  Slot(relative.empty() ? "/" : relative);
+
+  DIR* directory = opendir(path_.c_str());
+  if (directory == nullptr) {
+    return;  // removed while walking
+  }
+  size_t length{path_.size()};
+  while (dirent* entry = readdir(directory)) {
+    if (entry->d_name[0] == '.' ||
+        !LinuxParser::IsDirectory(dirfd(directory), entry->d_name,
+                                  entry->d_type)) {
+      continue;
+    }
+    path_ += '/';
+    path_ += entry->d_name;
+    Walk();
+    path_.resize(length);
+  }
+  closedir(directory);
+}
+
+// Reads the file of the group in path_ into buffer_. Returns the number
+// of bytes read, 0 if the group does not have the file. A read that
+// leaves room in the buffer has reached the end, as with ProcFile.
+size_t CgroupTable::Read(const char* filename) {
+  size_t directory{path_.size()};
+  path_ += '/';
+  path_ += filename;
+  Profiler::CountSyscalls();
+  int fd = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+  path_.resize(directory);
+  if (fd < 0) {
+    return 0;
+  }
+  size_t length{0};
+  while (true) {
+    Profiler::CountSyscalls();
+    ssize_t count = read(fd, buffer_.data() + length, buffer_.size() - length);
+    if (count <= 0) {
+      break;
+    }
+    length += static_cast<size_t>(count);
+    if (length < buffer_.size()) {
+      break;
+    }
+    buffer_.resize(buffer_.size() * 2);
+  }
+  Profiler::CountSyscalls();
+  close(fd);
+  return length;
+}
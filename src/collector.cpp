@@ -0,0 +1,197 @@
+#include "../include/collector.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+
+using Tier = Scheduler::Tier;
+
+Collector::Collector(System& system, std::size_t n, HistoryRing* recorder)
+    : system_(system),
+      n_(n),
+      recorder_(recorder),
+      sortKey_(system.GetSortKey()),
+      groupBy_(system.GetGroupBy()),
+      treeView_(system.GetTreeView()),
+      treeOffset_(system.GetTreeOffset()),
+      threadView_(system.GetThreadView()),
+      threadPid_(system.GetThreadPid()) {}
+
+Collector::~Collector() {
+  Stop();
+  if (notifier_ >= 0) {
+    close(notifier_);
+  }
+}
+
+bool Collector::Start() {
+  notifier_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (notifier_ < 0) {
+    perror("error while creating the collector eventfd");
+    return false;
+  }
+  thread_ = std::thread(&Collector::Run, this);
+  return true;
+}
+
+void Collector::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_one();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+// Applied by the collecting thread, which also brings the next full scan
+// forward, since only a scan has the new key of every process
+void Collector::SetSortKey(SortKey key) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sortKey_ = key;
+  }
+  wake_.notify_one();
+}
+
+// Grouping by user or cgroup brings the next full scan forward too, which
+// reads the uid or cgroup of every process
+void Collector::SetGroupBy(GroupBy by) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    groupBy_ = by;
+  }
+  wake_.notify_one();
+}
+
+// Changes of the tree view only need the rows again, not a full scan
+void Collector::SetTreeView(bool tree) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    treeView_ = tree;
+  }
+  wake_.notify_one();
+}
+
+void Collector::SetTreeOffset(std::size_t offset) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    treeOffset_ = offset;
+  }
+  wake_.notify_one();
+}
+
+void Collector::Toggle(int pid) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    toggles_.push_back(pid);
+  }
+  wake_.notify_one();
+}
+
+// Threads are read with the rows, so they only need the rows again too
+void Collector::SetThreadView(bool threads, int pid) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    threadView_ = threads;
+    threadPid_ = pid;
+  }
+  wake_.notify_one();
+}
+
+int Collector::Notifier() const { return notifier_; }
+
+void Collector::Acknowledge() {
+  std::uint64_t count;
+  while (read(notifier_, &count, sizeof(count)) > 0) {
+  }
+}
+
+// Refreshes whatever is due, publishes the result and sleeps until the
+// next tier is due or the renderer asks for something. A wakeup with
+// nothing due publishes nothing, so the renderer is not woken for a
+// snapshot it already has.
+void Collector::Run() {
+  Profiler& profiler{system_.GetProfiler()};
+  Scheduler scheduler;
+  unsigned long long sequence{0};
+  std::vector<int> toggles;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stop_) {
+    SortKey key{sortKey_};
+    GroupBy by{groupBy_};
+    bool tree{treeView_};
+    std::size_t offset{treeOffset_};
+    toggles.swap(toggles_);
+    bool threads{threadView_};
+    int pid{threadPid_};
+    lock.unlock();
+    if (key != system_.GetSortKey()) {
+      system_.SetSortKey(key);
+      scheduler.Expedite(Tier::kScan);
+    }
+    if (by != system_.GetGroupBy()) {
+      system_.SetGroupBy(by);
+      if (by == GroupBy::kUser || by == GroupBy::kCgroup) {
+        scheduler.Expedite(Tier::kScan);
+      } else {
+        scheduler.Expedite(Tier::kRows);
+      }
+    }
+    if (tree != system_.GetTreeView() ||
+        offset != system_.GetTreeOffset() || !toggles.empty()) {
+      system_.SetTreeView(tree);
+      system_.SetTreeOffset(offset);
+      for (int pid : toggles) {
+        system_.ToggleCollapsed(pid);
+      }
+      toggles.clear();
+      scheduler.Expedite(Tier::kRows);
+    }
+    if (threads != system_.GetThreadView() ||
+        pid != system_.GetThreadPid()) {
+      system_.SetThreadView(threads);
+      system_.SetThreadPid(pid);
+      scheduler.Expedite(Tier::kRows);
+    }
+    auto now = Scheduler::Clock::now();
+    if (scheduler.Next() <= now) {
+      Snapshot& snapshot{system_.Back()};
+      if (Refresh(scheduler, now, snapshot.frame)) {
+        profiler.EndTick();
+      }
+      profiler.Get(snapshot.profile);
+      snapshot.sequence = ++sequence;
+      system_.Publish();
+      std::uint64_t one{1};
+      if (write(notifier_, &one, sizeof(one)) < 0) {
+        // Only fails when the counter is full, and then it is readable
+      }
+    }
+    lock.lock();
+    wake_.wait_until(lock, scheduler.Next(), [&] {
+      return stop_ || sortKey_ != key || groupBy_ != by ||
+             treeView_ != tree || treeOffset_ != offset ||
+             !toggles_.empty() || threadView_ != threads ||
+             threadPid_ != pid;
+    });
+  }
+}
+
+// Runs the tiers that are due at now and fills frame, which holds an
+// older snapshot's. Returns true if the rows were refreshed, which is one
+// profiler tick.
+bool Collector::Refresh(Scheduler& scheduler,
+                        Scheduler::Clock::time_point now, Frame& frame) {
+  Profiler::Scope tick(system_.GetProfiler(), Profiler::Phase::kTick);
+  bool rows{system_.RefreshDue(scheduler, now, n_)};
+  system_.CollectSystem(frame);
+  system_.CollectProcesses(frame);
+  if (rows && recorder_ != nullptr) {
+    recorder_->Append(frame);
+  }
+  return rows;
+}
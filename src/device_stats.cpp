@@ -0,0 +1,197 @@
+#include "../include/device_stats.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+using std::size_t;
+using std::string;
+using std::uint32_t;
+
+// Rereads both files, returns false if either could not be read
+bool DeviceStats::Refresh() {
+  auto now = Clock::now();
+  bool ok = RefreshDisks(now);
+  ok = RefreshNetworks(now) && ok;
+  return ok;
+}
+
+const std::vector<DiskStat>& DeviceStats::Disks() const { return disks_; }
+
+const std::vector<NetStat>& DeviceStats::Networks() const {
+  return networks_;
+}
+
+std::string_view DeviceStats::Name(uint32_t id) const {
+  return names_.Get(id);
+}
+
+// Opens the /proc file on first use, or again after a failed read. A
+// file that cannot be opened is reported once, not on every refresh,
+// until it opens again.
+size_t DeviceStats::Read(ProcFile& file, const string& filename) {
+  if (!file.IsOpen()) {
+    string path{LinuxParser::ProcDirectory() + filename};
+    if (!file.Open(path)) {
+      if (file.FirstFailure()) {
+        perror(("error while opening the file " + path).c_str());
+      }
+      return 0;
+    }
+  }
+  return file.Read();
+}
+
+namespace {
+// The increase per second of a counter, 0 if it went back
+double Rate(long long now, long long before, double seconds) {
+  return std::max(0LL, now - before) / seconds;
+}
+}  // namespace
+
+// A device seen for the first time, or again after it was gone, has no
+// rates until the next refresh
+bool DeviceStats::RefreshDisks(Clock::time_point now) {
+  size_t length = Read(diskstats_, LinuxParser::kDiskstatsFilename);
+  if (length == 0) {
+    return false;
+  }
+
+  const char* p = diskstats_.Data();
+  const char* end = p + length;
+  LinuxParser::DiskRecord record;
+  size_t line{0};
+  uint32_t disk{UINT32_MAX};  // the id of the last one not a partition
+  disks_.clear();
+  while (p < end) {
+    p = LinuxParser::ParseDiskstatsLine(p, end, record);
+    if (record.name.empty()) {
+      continue;
+    }
+    uint32_t id{DiskId(line++, record)};
+    DiskCounters& counters = diskCounters_[id];
+    const LinuxParser::DiskRecord& last = counters.record;
+    if (counters.sampled == Clock::time_point{}) {
+      // Partitions follow their disk and extend its name: sda1, nvme0n1p1
+      std::string_view name{disk != UINT32_MAX ? names_.Get(disk) : ""};
+      counters.partition =
+          disk != UINT32_MAX &&
+          diskCounters_[disk].record.major == record.major &&
+          record.name.size() > name.size() &&
+          record.name.compare(0, name.size(), name) == 0;
+    } else if (!counters.partition &&
+               (record.reads > 0 || record.writes > 0)) {
+      double seconds{
+          std::chrono::duration<double>(now - counters.sampled).count()};
+      if (seconds > 0) {
+        DiskStat stat{id};
+        stat.readsPerSecond = Rate(record.reads, last.reads, seconds);
+        stat.writesPerSecond = Rate(record.writes, last.writes, seconds);
+        stat.readBytesPerSecond =
+            Rate(record.readSectors, last.readSectors, seconds) * 512;
+        stat.writeBytesPerSecond =
+            Rate(record.writeSectors, last.writeSectors, seconds) * 512;
+        double milliseconds{seconds * 1000};
+        stat.utilization = static_cast<float>(std::min(
+            1.0, Rate(record.ioTicks, last.ioTicks, milliseconds)));
+        stat.queueDepth = static_cast<float>(
+            Rate(record.weightedTicks, last.weightedTicks, milliseconds));
+        disks_.push_back(stat);
+      }
+    }
+    if (!counters.partition) {
+      disk = id;
+    }
+    counters.record = record;
+    counters.record.name = names_.Get(id);  // outlives the buffer
+    counters.sampled = now;
+  }
+  diskLines_.resize(line);
+  return true;
+}
+
+bool DeviceStats::RefreshNetworks(Clock::time_point now) {
+  size_t length = Read(netDev_, LinuxParser::kNetDevFilename);
+  if (length == 0) {
+    return false;
+  }
+
+  const char* p = netDev_.Data();
+  const char* end = p + length;
+  LinuxParser::NetRecord record;
+  size_t line{0};
+  networks_.clear();
+  while (p < end) {
+    p = LinuxParser::ParseNetDevLine(p, end, record);
+    if (record.name.empty()) {
+      continue;
+    }
+    uint32_t id{NetId(line++, record)};
+    NetCounters& counters = netCounters_[id];
+    const LinuxParser::NetRecord& last = counters.record;
+    double seconds{
+        std::chrono::duration<double>(now - counters.sampled).count()};
+    if (counters.sampled != Clock::time_point{} && seconds > 0) {
+      NetStat stat{id};
+      stat.rxBytesPerSecond = Rate(record.rxBytes, last.rxBytes, seconds);
+      stat.txBytesPerSecond = Rate(record.txBytes, last.txBytes, seconds);
+      stat.rxPacketsPerSecond =
+          Rate(record.rxPackets, last.rxPackets, seconds);
+      stat.txPacketsPerSecond =
+          Rate(record.txPackets, last.txPackets, seconds);
+      stat.rxDropsPerSecond = Rate(record.rxDrops, last.rxDrops, seconds);
+      stat.txDropsPerSecond = Rate(record.txDrops, last.txDrops, seconds);
+      networks_.push_back(stat);
+    }
+    counters.record = record;
+    counters.record.name = names_.Get(id);
+    counters.sampled = now;
+  }
+  netLines_.resize(line);
+  return true;
+}
+
+// The id of the device on line, which is the one of the last refresh if
+// major and minor still match
+uint32_t DeviceStats::DiskId(size_t line,
+                             const LinuxParser::DiskRecord& record) {
+  if (line < diskLines_.size()) {
+    const LinuxParser::DiskRecord& last =
+        diskCounters_[diskLines_[line]].record;
+    if (last.major == record.major && last.minor == record.minor) {
+      return diskLines_[line];
+    }
+  }
+  uint32_t id{names_.Id(record.name)};
+  if (id >= diskCounters_.size()) {
+    diskCounters_.resize(id + 1);
+  }
+  if (line >= diskLines_.size()) {
+    diskLines_.resize(line + 1);
+  }
+  // A different device under the name of one that is gone
+  DiskCounters& counters = diskCounters_[id];
+  if (counters.record.major != record.major ||
+      counters.record.minor != record.minor) {
+    counters = DiskCounters{};
+  }
+  diskLines_[line] = id;
+  return id;
+}
+
+// Interfaces have no numbers, the name of the last refresh is compared
+uint32_t DeviceStats::NetId(size_t line,
+                            const LinuxParser::NetRecord& record) {
+  if (line < netLines_.size() && names_.Get(netLines_[line]) == record.name) {
+    return netLines_[line];
+  }
+  uint32_t id{names_.Id(record.name)};
+  if (id >= netCounters_.size()) {
+    netCounters_.resize(id + 1);
+  }
+  if (line >= netLines_.size()) {
+    netLines_.resize(line + 1);
+  }
+  netLines_[line] = id;
+  return id;
+}
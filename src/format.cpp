@@ -1,6 +1,5 @@
 #include "../include/format.h"
-#include <iostream>
-#include <iomanip>
+#include <cstdio>
 #include <string>
 
 using std::string;
@@ -10,16 +9,20 @@ using std::string;
 // OUTPUT: HH:MM:SS
 // REMOVE: [[maybe_unused]] once you define the function
 string Format::ElapsedTime(long seconds) {
+  char buffer[32];
+  ElapsedTime(seconds, buffer, sizeof(buffer));
+  return buffer;
+}
+
+// Same text formatted into the caller's buffer; hours take as many digits
+// as they need
+void Format::ElapsedTime(long seconds, char* buffer, std::size_t size) {
   const int ONE_HOUR = (60 * 60);
   const int ONE_MINUTE = 60;
 
-  int hours{static_cast<int>(seconds / 3600)};  
-  seconds = seconds % ONE_HOUR;                    
-  int minutes = seconds / ONE_MINUTE;
-  std::string result{};
-  std::ostringstream is(result);
-  is << std::setfill('0') << std::setw(2) << hours << ":";
-  is << std::setfill('0') << std::setw(2) << minutes << ":";
-  is << std::setfill('0') << std::setw(2) << seconds % 60;
-  return is.str(); 
-}
\ No newline at end of file
+  long hours{seconds / ONE_HOUR};
+  seconds = seconds % ONE_HOUR;
+  long minutes = seconds / ONE_MINUTE;
+  std::snprintf(buffer, size, "%02ld:%02ld:%02ld", hours, minutes,
+                seconds % ONE_MINUTE);
+}
@@ -0,0 +1,352 @@
+#include "../include/frame_writer.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include "../include/profiler.h"
+
+using std::size_t;
+
+namespace {
+// Holds a typical frame, so the buffer only grows for very long commands
+const size_t kInitialSize{16 * 1024};
+
+// Length of the well-formed UTF-8 sequence text starts with, or 0 when it
+// is not one: a stray continuation byte, an overlong form, a surrogate,
+// a code point past U+10FFFF, or a sequence cut short, as the kernel cuts
+// command names at 15 bytes
+size_t Utf8Length(const unsigned char* text) {
+  unsigned char lead{text[0]};
+  size_t length{0};
+  unsigned char low{0x80};
+  unsigned char high{0xbf};
+  if (lead >= 0xc2 && lead <= 0xdf) {
+    length = 2;
+  } else if (lead >= 0xe0 && lead <= 0xef) {
+    length = 3;
+    low = lead == 0xe0 ? 0xa0 : low;
+    high = lead == 0xed ? 0x9f : high;
+  } else if (lead >= 0xf0 && lead <= 0xf4) {
+    length = 4;
+    low = lead == 0xf0 ? 0x90 : low;
+    high = lead == 0xf4 ? 0x8f : high;
+  } else {
+    return 0;
+  }
+  // Only the second byte has a narrower range. The terminating NUL fails
+  // the test, so a cut sequence is never read past.
+  for (size_t i{1}; i < length; ++i) {
+    if (text[i] < low || text[i] > high) {
+      return 0;
+    }
+    low = 0x80;
+    high = 0xbf;
+  }
+  return length;
+}
+}  // namespace
+
+FrameWriter::FrameWriter(int fd, Format format)
+    : fd_(fd), format_(format), buffer_(kInitialSize) {}
+
+// Returns false if the record could not be written completely
+bool FrameWriter::Write(const Frame& frame) {
+  length_ = 0;
+  if (format_ == Format::kJsonLines) {
+    SerializeJson(frame);
+  } else {
+    SerializeBinary(frame);
+  }
+
+  size_t written{0};
+  while (written < length_) {
+    Profiler::CountSyscalls();
+    ssize_t count = write(fd_, buffer_.data() + written, length_ - written);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      return false;
+    }
+    written += static_cast<size_t>(count);
+  }
+  return true;
+}
+
+void FrameWriter::SerializeJson(const Frame& frame) {
+  Append("{\"timestamp_ms\":");
+  AppendNumber(static_cast<long long>(frame.timestampMs));
+  Append(",\"cpu\":");
+  AppendNumber(frame.cpu, 4);
+  Append(",\"cores\":[");
+  for (size_t i{0}; i < frame.cores.size(); ++i) {
+    if (i > 0) Append(",");
+    AppendNumber(frame.cores[i], 4);
+  }
+  Append("],\"memory\":");
+  AppendNumber(frame.memory, 4);
+  Append(",\"total_processes\":");
+  AppendNumber(static_cast<long long>(frame.totalProcesses));
+  Append(",\"running_processes\":");
+  AppendNumber(static_cast<long long>(frame.runningProcesses));
+  Append(",\"uptime\":");
+  AppendNumber(static_cast<long long>(frame.upTime));
+  Append(",\"load_average\":[");
+  for (int i{0}; i < 3; ++i) {
+    if (i > 0) Append(",");
+    AppendNumber(frame.loadAverage[i], 2);
+  }
+  Append("],\"disks\":[");
+  for (size_t i{0}; i < frame.disks.size(); ++i) {
+    const DiskRow& disk = frame.disks[i];
+    Append(i > 0 ? ",{\"name\":" : "{\"name\":");
+    AppendJsonString(disk.name);
+    Append(",\"reads_per_s\":");
+    AppendNumber(disk.readsPerSecond, 1);
+    Append(",\"writes_per_s\":");
+    AppendNumber(disk.writesPerSecond, 1);
+    Append(",\"read_kb_per_s\":");
+    AppendNumber(static_cast<long long>(disk.readKbPerSecond));
+    Append(",\"write_kb_per_s\":");
+    AppendNumber(static_cast<long long>(disk.writeKbPerSecond));
+    Append(",\"utilization\":");
+    AppendNumber(disk.utilization, 4);
+    Append(",\"queue_depth\":");
+    AppendNumber(disk.queueDepth, 2);
+    Append("}");
+  }
+  Append("],\"networks\":[");
+  for (size_t i{0}; i < frame.networks.size(); ++i) {
+    const NetRow& network = frame.networks[i];
+    Append(i > 0 ? ",{\"name\":" : "{\"name\":");
+    AppendJsonString(network.name);
+    Append(",\"rx_kb_per_s\":");
+    AppendNumber(static_cast<long long>(network.rxKbPerSecond));
+    Append(",\"tx_kb_per_s\":");
+    AppendNumber(static_cast<long long>(network.txKbPerSecond));
+    Append(",\"rx_packets_per_s\":");
+    AppendNumber(network.rxPacketsPerSecond, 1);
+    Append(",\"tx_packets_per_s\":");
+    AppendNumber(network.txPacketsPerSecond, 1);
+    Append(",\"rx_drops_per_s\":");
+    AppendNumber(network.rxDropsPerSecond, 1);
+    Append(",\"tx_drops_per_s\":");
+    AppendNumber(network.txDropsPerSecond, 1);
+    Append("}");
+  }
+  Append("],\"processes\":[");
+  for (size_t i{0}; i < frame.rows.size(); ++i) {
+    const ProcessRow& row = frame.rows[i];
+    Append(i > 0 ? ",{\"pid\":" : "{\"pid\":");
+    AppendNumber(static_cast<long long>(row.pid));
+    Append(",\"user\":");
+    AppendJsonString(row.user);
+    Append(",\"cpu\":");
+    AppendNumber(row.cpu, 4);
+    Append(",\"rss_mb\":");
+    AppendNumber(static_cast<long long>(row.rssMb));
+    Append(",\"pss_mb\":");
+    AppendNumber(static_cast<long long>(row.pssMb));
+    Append(",\"shared_mb\":");
+    AppendNumber(static_cast<long long>(row.sharedMb));
+    Append(",\"private_mb\":");
+    AppendNumber(static_cast<long long>(row.privateMb));
+    Append(",\"swap_mb\":");
+    AppendNumber(static_cast<long long>(row.swapMb));
+    Append(",\"read_kb_per_s\":");
+    AppendNumber(static_cast<long long>(row.readKbPerSecond));
+    Append(",\"write_kb_per_s\":");
+    AppendNumber(static_cast<long long>(row.writeKbPerSecond));
+    Append(",\"read_calls_per_s\":");
+    AppendNumber(row.readCallsPerSecond, 1);
+    Append(",\"write_calls_per_s\":");
+    AppendNumber(row.writeCallsPerSecond, 1);
+    Append(",\"uptime\":");
+    AppendNumber(static_cast<long long>(row.upTime));
+    Append(",\"command\":");
+    AppendJsonString(row.command);
+    if (frame.treeView && i < frame.tree.size()) {
+      const TreeRow& line = frame.tree[i];
+      Append(",\"depth\":");
+      AppendNumber(static_cast<long long>(line.depth));
+      Append(",\"collapsed\":");
+      Append(line.collapsed ? "true" : "false");
+      Append(",\"subtree_processes\":");
+      AppendNumber(static_cast<long long>(line.processes));
+      Append(",\"subtree_cpu\":");
+      AppendNumber(line.cpu, 4);
+      Append(",\"subtree_rss_mb\":");
+      AppendNumber(static_cast<long long>(line.rssMb));
+    }
+    Append("}");
+  }
+  Append("]");
+  if (frame.groupBy == GroupBy::kCgroup) {
+    Append(",\"cgroups\":[");
+    for (size_t i{0}; i < frame.cgroups.size(); ++i) {
+      const CgroupRow& cgroup = frame.cgroups[i];
+      Append(i > 0 ? ",{\"path\":" : "{\"path\":");
+      AppendJsonString(cgroup.path);
+      Append(",\"processes\":");
+      AppendNumber(static_cast<long long>(cgroup.processes));
+      Append(",\"cpu\":");
+      AppendNumber(cgroup.cpu, 4);
+      Append(",\"throttled\":");
+      AppendNumber(cgroup.throttled, 4);
+      Append(",\"memory_mb\":");
+      AppendNumber(static_cast<long long>(cgroup.memoryMb));
+      Append(",\"anon_mb\":");
+      AppendNumber(static_cast<long long>(cgroup.anonMb));
+      Append(",\"file_mb\":");
+      AppendNumber(static_cast<long long>(cgroup.fileMb));
+      Append(",\"read_kb_per_s\":");
+      AppendNumber(static_cast<long long>(cgroup.readKbPerSecond));
+      Append(",\"write_kb_per_s\":");
+      AppendNumber(static_cast<long long>(cgroup.writeKbPerSecond));
+      Append("}");
+    }
+    Append("]");
+  } else if (frame.groupBy != GroupBy::kNone) {
+    Append(frame.groupBy == GroupBy::kUser ? ",\"users\":["
+                                           : ",\"commands\":[");
+    for (size_t i{0}; i < frame.groups.size(); ++i) {
+      const GroupRow& group = frame.groups[i];
+      Append(i > 0 ? ",{\"name\":" : "{\"name\":");
+      AppendJsonString(group.name);
+      Append(",\"processes\":");
+      AppendNumber(static_cast<long long>(group.processes));
+      Append(",\"cpu\":");
+      AppendNumber(group.cpu, 4);
+      Append(",\"rss_mb\":");
+      AppendNumber(static_cast<long long>(group.rssMb));
+      Append("}");
+    }
+    Append("]");
+  }
+  if (frame.threadView) {
+    Append(",\"threads\":[");
+    for (size_t i{0}; i < frame.threads.size(); ++i) {
+      const ThreadRow& thread = frame.threads[i];
+      Append(i > 0 ? ",{\"pid\":" : "{\"pid\":");
+      AppendNumber(static_cast<long long>(thread.pid));
+      Append(",\"tid\":");
+      AppendNumber(static_cast<long long>(thread.tid));
+      Append(",\"name\":");
+      AppendJsonString(thread.name);
+      char state[2]{thread.state, '\0'};
+      Append(",\"state\":");
+      AppendJsonString(state);
+      Append(",\"processor\":");
+      AppendNumber(static_cast<long long>(thread.processor));
+      Append(",\"cpu\":");
+      AppendNumber(thread.cpu, 4);
+      Append("}");
+    }
+    Append("]");
+  }
+  Append("}\n");
+}
+
+void FrameWriter::SerializeBinary(const Frame& frame) {
+  AppendRaw<std::uint32_t>(0);  // patched with the length below
+  AppendRaw<std::uint16_t>(kBinaryVersion);
+  AppendRaw<std::int64_t>(frame.timestampMs);
+  AppendRaw<float>(frame.cpu);
+  AppendRaw<float>(frame.memory);
+  AppendRaw<std::uint32_t>(frame.totalProcesses);
+  AppendRaw<std::uint32_t>(frame.runningProcesses);
+  AppendRaw<std::int64_t>(frame.upTime);
+  for (double load : frame.loadAverage) {
+    AppendRaw<double>(load);
+  }
+  AppendRaw<std::uint16_t>(static_cast<std::uint16_t>(frame.cores.size()));
+  for (float core : frame.cores) {
+    AppendRaw<float>(core);
+  }
+  AppendRaw<std::uint16_t>(static_cast<std::uint16_t>(frame.rows.size()));
+  for (const ProcessRow& row : frame.rows) {
+    AppendRaw<std::int32_t>(row.pid);
+    AppendRaw<float>(row.cpu);
+    AppendRaw<std::int64_t>(row.rssMb);
+    AppendRaw<std::int64_t>(row.pssMb);
+    AppendRaw<std::int64_t>(row.sharedMb);
+    AppendRaw<std::int64_t>(row.privateMb);
+    AppendRaw<std::int64_t>(row.swapMb);
+    AppendRaw<std::int64_t>(row.upTime);
+    size_t user = strnlen(row.user, sizeof(row.user));
+    AppendRaw<std::uint8_t>(static_cast<std::uint8_t>(user));
+    Append(row.user, user);
+    size_t command = strnlen(row.command, sizeof(row.command));
+    AppendRaw<std::uint16_t>(static_cast<std::uint16_t>(command));
+    Append(row.command, command);
+  }
+
+  std::uint32_t length = static_cast<std::uint32_t>(length_ - 4);
+  std::memcpy(buffer_.data(), &length, sizeof(length));
+}
+
+void FrameWriter::Append(const char* data, size_t length) {
+  if (length_ + length > buffer_.size()) {
+    buffer_.resize(std::max(buffer_.size() * 2, length_ + length));
+  }
+  std::memcpy(buffer_.data() + length_, data, length);
+  length_ += length;
+}
+
+void FrameWriter::Append(const char* text) { Append(text, std::strlen(text)); }
+
+void FrameWriter::AppendNumber(long long value) {
+  char text[24];
+  int length = std::snprintf(text, sizeof(text), "%lld", value);
+  Append(text, static_cast<size_t>(length));
+}
+
+void FrameWriter::AppendNumber(double value, int decimals) {
+  char text[48];
+  int length = std::snprintf(text, sizeof(text), "%.*f", decimals, value);
+  Append(text, static_cast<size_t>(length));
+}
+
+// Escapes quotes, backslashes and control characters. Names from /proc
+// are bytes, not text, so each byte that does not start a well-formed
+// UTF-8 sequence becomes U+FFFD and the output stays valid JSON.
+void FrameWriter::AppendJsonString(const char* text) {
+  Append("\"");
+  for (const char* c = text; *c != '\0';) {
+    unsigned char byte = static_cast<unsigned char>(*c);
+    if (byte == '"' || byte == '\\') {
+      char escaped[2] = {'\\', *c};
+      Append(escaped, 2);
+      ++c;
+    } else if (byte < 0x20) {
+      char escaped[8];
+      int length = std::snprintf(escaped, sizeof(escaped), "\\u%04x", byte);
+      Append(escaped, static_cast<size_t>(length));
+      ++c;
+    } else if (byte < 0x80) {
+      Append(c, 1);
+      ++c;
+    } else {
+      size_t length{Utf8Length(reinterpret_cast<const unsigned char*>(c))};
+      if (length == 0) {
+        Append("\\ufffd");
+        ++c;
+      } else {
+        Append(c, length);
+        c += length;
+      }
+    }
+  }
+  Append("\"");
+}
+
+// Host byte order, which is little-endian on every target the monitor
+// runs on
+template <typename T>
+void FrameWriter::AppendRaw(T value) {
+  Append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
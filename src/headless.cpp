@@ -0,0 +1,123 @@
+#include "../include/headless.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include "../include/frame.h"
+#include "../include/frame_writer.h"
+#include "../include/profiler.h"
+#include "../include/scheduler.h"
+
+using std::string;
+
+namespace {
+// "-" is stdout. Returns -1, after reporting why, on failure.
+int OpenOutput(const string& filename) {
+  if (filename == "-") {
+    return STDOUT_FILENO;
+  }
+  int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+                0644);
+  if (fd < 0) {
+    perror(("error while opening the file " + filename).c_str());
+  }
+  return fd;
+}
+
+bool WriteAll(int fd, const string& text) {
+  size_t written{0};
+  while (written < text.size()) {
+    ssize_t count = write(fd, text.data() + written, text.size() - written);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      return false;
+    }
+    written += static_cast<size_t>(count);
+  }
+  return true;
+}
+}  // namespace
+
+// Collects a frame every options.intervalMs and streams it to
+// options.output. Ticks are scheduled against a fixed timeline, so the
+// time spent collecting does not stretch the interval. Each frame has
+// fresh system figures; the processes follow the live view's tiers, the
+// rows shown once a second and a full scan only when the Scheduler has
+// one due, and a frame in between repeats the last rows. The tiers are
+// timed by the timeline rather than the clock, so a tick that wakes late
+// does not push the next refresh back. Never touches ncurses. Frames
+// also go to recorder, if any, and the monitor's own profile to
+// options.profile, if set. Returns the process exit status.
+int Headless::Run(System& system, const Options& options,
+                  HistoryRing* recorder) {
+  int fd = OpenOutput(options.output);
+  int profileFd = options.profile.empty() ? -1 : OpenOutput(options.profile);
+  if (fd < 0 || (!options.profile.empty() && profileFd < 0)) {
+    return 1;
+  }
+
+  FrameWriter writer(fd, options.format);
+  Frame frame;
+  frame.rows.reserve(options.top);
+  auto interval = std::chrono::milliseconds(options.intervalMs);
+  Scheduler scheduler;
+  auto next = Scheduler::Clock::now();
+  Profiler& profiler{system.GetProfiler()};
+  string line;
+  int status{0};
+  for (long tick{0}; options.count == 0 || tick < options.count; ++tick) {
+    bool written{false};
+    {
+      Profiler::Scope scope(profiler, Profiler::Phase::kTick);
+      scheduler.Expedite(Scheduler::Tier::kSystem);
+      system.RefreshDue(scheduler, next, options.top);
+      system.CollectSystem(frame);
+      system.CollectProcesses(frame);
+      {
+        Profiler::Scope output(profiler, Profiler::Phase::kOutput);
+        written = writer.Write(frame);
+      }
+      if (recorder != nullptr) {
+        recorder->Append(frame);
+      }
+    }
+    profiler.EndTick();
+    if (!written) {
+      perror("error while writing a frame");
+      status = 1;
+      break;
+    }
+
+    // {"timestamp_ms":...,"ticks":...,"profile":{"tick":{...},...}}
+    if (profileFd >= 0) {
+      line = "{\"timestamp_ms\":" + std::to_string(frame.timestampMs) +
+             ",\"ticks\":" + std::to_string(profiler.Ticks()) +
+             ",\"profile\":";
+      profiler.AppendJson(line);
+      line += "}\n";
+      if (!WriteAll(profileFd, line)) {
+        perror("error while writing the profile");
+        status = 1;
+        break;
+      }
+    }
+    next += interval;
+    std::this_thread::sleep_until(next);
+  }
+
+  if (fd != STDOUT_FILENO) {
+    close(fd);
+  }
+  if (profileFd >= 0 && profileFd != STDOUT_FILENO) {
+    close(profileFd);
+  }
+  return status;
+}
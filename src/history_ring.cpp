@@ -0,0 +1,391 @@
+#include "../include/history_ring.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+using std::size_t;
+using std::string;
+
+namespace {
+const char kMagic[8] = {'S', 'M', 'H', 'I', 'S', 'T', '\0', '\1'};
+const std::uint32_t kVersion{2};
+const size_t kHeaderSize{4096};
+const size_t kUserLength{32};
+
+size_t Align(size_t offset) { return (offset + 7) & ~size_t{7}; }
+
+// The file length of capacity slots of slotSize bytes. False if it does
+// not fit a size_t, as with a capacity read from a corrupt header.
+bool RingLength(size_t slotSize, std::uint64_t capacity, size_t& length) {
+  return capacity <= SIZE_MAX &&
+         !__builtin_mul_overflow(slotSize, static_cast<size_t>(capacity),
+                                 &length) &&
+         !__builtin_add_overflow(length, kHeaderSize, &length);
+}
+
+// Copies a NUL terminated string into a fixed field, cutting it to fit
+void CopyText(char* to, size_t size, const char* from) {
+  size_t length = strnlen(from, size - 1);
+  std::memcpy(to, from, length);
+  to[length] = '\0';
+}
+}  // namespace
+
+struct HistoryRing::Header {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t slotSize;
+  std::uint64_t capacity;
+  std::uint32_t rows;
+  std::uint32_t cores;
+  // Frames appended over the life of the file, only accessed atomically
+  std::uint64_t written;
+  char os[64];
+  char kernel[64];
+};
+
+struct HistoryRing::SlotHeader {
+  std::int64_t timestampMs;
+  std::int64_t upTime;
+  double loadAverage[3];
+  float cpu;
+  float memory;
+  std::int32_t totalProcesses;
+  std::int32_t runningProcesses;
+  std::int32_t shortLivedProcesses;
+  std::int16_t sortKey;
+  std::uint16_t cores;
+  std::uint16_t rows;
+};
+
+HistoryRing::~HistoryRing() { Unmap(); }
+
+HistoryRing::Layout HistoryRing::Plan(int rows, int cores) {
+  Layout layout{};
+  size_t offset{Align(sizeof(SlotHeader))};
+  layout.cores = offset;
+  offset = Align(offset + sizeof(float) * cores);
+  layout.pid = offset;
+  offset = Align(offset + sizeof(std::int32_t) * rows);
+  layout.cpu = offset;
+  offset = Align(offset + sizeof(float) * rows);
+  layout.rssMb = offset;
+  offset = Align(offset + sizeof(std::int64_t) * rows);
+  layout.pssMb = offset;
+  offset = Align(offset + sizeof(std::int64_t) * rows);
+  layout.sharedMb = offset;
+  offset = Align(offset + sizeof(std::int64_t) * rows);
+  layout.privateMb = offset;
+  offset = Align(offset + sizeof(std::int64_t) * rows);
+  layout.swapMb = offset;
+  offset = Align(offset + sizeof(std::int64_t) * rows);
+  layout.upTime = offset;
+  offset = Align(offset + sizeof(std::int64_t) * rows);
+  layout.user = offset;
+  offset = Align(offset + kUserLength * rows);
+  layout.command = offset;
+  layout.size = Align(offset + kCommandLength * rows);
+  return layout;
+}
+
+bool HistoryRing::Create(const string& filename, size_t capacity, int rows,
+                         int cores) {
+  Unmap();
+  // One slot is being written
+  capacity = std::clamp<size_t>(capacity, 2, kMaxCapacity);
+  rows = std::clamp<int>(rows, 0, kMaxRows);
+  cores = std::clamp<int>(cores, 0, kMaxCores);
+  layout_ = Plan(rows, cores);
+  size_t length{0};
+  if (!RingLength(layout_.size, capacity, length)) {
+    std::fprintf(stderr, "history file too large: %s\n", filename.c_str());
+    return false;
+  }
+  int fd = open(filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    perror(("error while opening the file " + filename).c_str());
+    return false;
+  }
+
+  struct stat info {};
+  bool reuse{false};
+  if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) == length) {
+    Header existing{};
+    reuse = pread(fd, &existing, sizeof(existing), 0) ==
+                static_cast<ssize_t>(sizeof(existing)) &&
+            std::memcmp(existing.magic, kMagic, sizeof(kMagic)) == 0 &&
+            existing.version == kVersion &&
+            existing.slotSize == layout_.size &&
+            existing.capacity == capacity &&
+            existing.rows == static_cast<std::uint32_t>(rows) &&
+            existing.cores == static_cast<std::uint32_t>(cores);
+  }
+  if (!reuse && (ftruncate(fd, 0) != 0 ||
+                 ftruncate(fd, static_cast<off_t>(length)) != 0)) {
+    perror(("error while sizing the file " + filename).c_str());
+    close(fd);
+    return false;
+  }
+
+  bool mapped = Map(fd, length, true);
+  close(fd);
+  if (!mapped) {
+    return false;
+  }
+  if (!reuse) {
+    Header* h = Head();
+    std::memcpy(h->magic, kMagic, sizeof(kMagic));
+    h->version = kVersion;
+    h->slotSize = static_cast<std::uint32_t>(layout_.size);
+    h->capacity = capacity;
+    h->rows = static_cast<std::uint32_t>(rows);
+    h->cores = static_cast<std::uint32_t>(cores);
+    h->written = 0;
+  }
+  return true;
+}
+
+bool HistoryRing::Open(const string& filename) {
+  Unmap();
+  int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    perror(("error while opening the file " + filename).c_str());
+    return false;
+  }
+  struct stat info {};
+  Header existing{};
+  bool valid = fstat(fd, &info) == 0 &&
+               static_cast<size_t>(info.st_size) >= kHeaderSize &&
+               pread(fd, &existing, sizeof(existing), 0) ==
+                   static_cast<ssize_t>(sizeof(existing)) &&
+               std::memcmp(existing.magic, kMagic, sizeof(kMagic)) == 0 &&
+               existing.version == kVersion;
+  // A capacity below 2 has no readable slot and would divide by zero; a
+  // geometry past the limits is checked before Plan() computes with it
+  valid = valid && existing.capacity >= 2 &&
+          existing.capacity <= kMaxCapacity && existing.rows <= kMaxRows &&
+          existing.cores <= kMaxCores;
+  size_t length{0};
+  if (valid) {
+    layout_ = Plan(static_cast<int>(existing.rows),
+                   static_cast<int>(existing.cores));
+    valid = layout_.size == existing.slotSize &&
+            RingLength(layout_.size, existing.capacity, length) &&
+            static_cast<size_t>(info.st_size) == length;
+  }
+  if (!valid) {
+    std::fprintf(stderr, "not a history file: %s\n", filename.c_str());
+    close(fd);
+    return false;
+  }
+  bool mapped = Map(fd, static_cast<size_t>(info.st_size), false);
+  close(fd);
+  return mapped;
+}
+
+bool HistoryRing::Map(int fd, size_t length, bool writable) {
+  int protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+  void* data = mmap(nullptr, length, protection, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) {
+    perror("error while mapping the history file");
+    return false;
+  }
+  data_ = static_cast<char*>(data);
+  length_ = length;
+  return true;
+}
+
+void HistoryRing::Unmap() {
+  if (data_ != nullptr) {
+    munmap(data_, length_);
+    data_ = nullptr;
+    length_ = 0;
+  }
+}
+
+HistoryRing::Header* HistoryRing::Head() const {
+  return reinterpret_cast<Header*>(data_);
+}
+
+// Acquires the slots published by the release in Append(), which a
+// replay in another process may be reading while they are recorded
+std::uint64_t HistoryRing::Written() const {
+  return __atomic_load_n(&Head()->written, __ATOMIC_ACQUIRE);
+}
+
+// The slot the next Append() fills holds the oldest frame once the ring
+// is full, so that frame is never counted as readable
+std::uint64_t HistoryRing::Readable(std::uint64_t written) const {
+  return std::min(written, Head()->capacity - 1);
+}
+
+char* HistoryRing::Slot(std::uint64_t sequence) const {
+  return data_ + kHeaderSize + layout_.size * (sequence % Head()->capacity);
+}
+
+// Fills the slot first and publishes it by bumping written afterwards,
+// with release order so no store to the slot moves past it
+void HistoryRing::Append(const Frame& frame) {
+  if (data_ == nullptr) {
+    return;
+  }
+  Header* h = Head();
+  if (h->os[0] == '\0') {
+    std::memcpy(h->os, frame.os, sizeof(h->os));
+    std::memcpy(h->kernel, frame.kernel, sizeof(h->kernel));
+  }
+
+  std::uint64_t written{Written()};
+  char* slot = Slot(written);
+  SlotHeader top{};
+  top.timestampMs = frame.timestampMs;
+  top.upTime = frame.upTime;
+  std::copy(frame.loadAverage, frame.loadAverage + 3, top.loadAverage);
+  top.cpu = frame.cpu;
+  top.memory = frame.memory;
+  top.totalProcesses = frame.totalProcesses;
+  top.runningProcesses = frame.runningProcesses;
+  top.shortLivedProcesses = frame.shortLivedProcesses;
+  top.sortKey = static_cast<std::int16_t>(frame.sortKey);
+  top.cores = static_cast<std::uint16_t>(
+      std::min<size_t>(frame.cores.size(), h->cores));
+  top.rows = static_cast<std::uint16_t>(
+      std::min<size_t>(frame.rows.size(), h->rows));
+  std::memcpy(slot, &top, sizeof(top));
+
+  std::memcpy(slot + layout_.cores, frame.cores.data(),
+              sizeof(float) * top.cores);
+  auto* pid = reinterpret_cast<std::int32_t*>(slot + layout_.pid);
+  auto* cpu = reinterpret_cast<float*>(slot + layout_.cpu);
+  auto column = [slot](std::size_t offset) {
+    return reinterpret_cast<std::int64_t*>(slot + offset);
+  };
+  auto* rssMb = column(layout_.rssMb);
+  auto* pssMb = column(layout_.pssMb);
+  auto* sharedMb = column(layout_.sharedMb);
+  auto* privateMb = column(layout_.privateMb);
+  auto* swapMb = column(layout_.swapMb);
+  auto* upTime = column(layout_.upTime);
+  char* user = slot + layout_.user;
+  char* command = slot + layout_.command;
+  for (size_t i{0}; i < top.rows; ++i) {
+    const ProcessRow& row = frame.rows[i];
+    pid[i] = row.pid;
+    cpu[i] = row.cpu;
+    rssMb[i] = row.rssMb;
+    pssMb[i] = row.pssMb;
+    sharedMb[i] = row.sharedMb;
+    privateMb[i] = row.privateMb;
+    swapMb[i] = row.swapMb;
+    upTime[i] = row.upTime;
+    CopyText(user + i * kUserLength, kUserLength, row.user);
+    CopyText(command + i * kCommandLength, kCommandLength, row.command);
+  }
+  __atomic_store_n(&h->written, written + 1, __ATOMIC_RELEASE);
+}
+
+size_t HistoryRing::Size() const {
+  if (data_ == nullptr) {
+    return 0;
+  }
+  return static_cast<size_t>(Readable(Written()));
+}
+
+// Timestamp of a frame without decoding the rest of it
+std::int64_t HistoryRing::Timestamp(size_t index) const {
+  if (data_ == nullptr) {
+    return 0;
+  }
+  std::uint64_t written{Written()};
+  std::uint64_t size{Readable(written)};
+  if (index >= size) {
+    return 0;
+  }
+  SlotHeader top;
+  std::memcpy(&top, Slot(written - size + index), sizeof(top));
+  return top.timestampMs;
+}
+
+// Returns false as well if a recording still running overwrote the slot
+// while it was being read
+bool HistoryRing::Read(size_t index, Frame& frame) const {
+  if (data_ == nullptr) {
+    return false;
+  }
+  const Header* h = Head();
+  std::uint64_t written{Written()};
+  std::uint64_t size{Readable(written)};
+  if (index >= size) {
+    return false;
+  }
+  std::uint64_t sequence{written - size + index};
+  const char* slot = Slot(sequence);
+  SlotHeader top;
+  std::memcpy(&top, slot, sizeof(top));
+  // A torn header must not send the copies below past the slot
+  top.cores = static_cast<std::uint16_t>(std::min<std::uint64_t>(
+      top.cores, h->cores));
+  top.rows = static_cast<std::uint16_t>(std::min<std::uint64_t>(
+      top.rows, h->rows));
+
+  frame.timestampMs = top.timestampMs;
+  std::snprintf(frame.os, sizeof(frame.os), "%s", h->os);
+  std::snprintf(frame.kernel, sizeof(frame.kernel), "%s", h->kernel);
+  frame.cpu = top.cpu;
+  frame.memory = top.memory;
+  frame.totalProcesses = top.totalProcesses;
+  frame.runningProcesses = top.runningProcesses;
+  frame.shortLivedProcesses = top.shortLivedProcesses;
+  frame.upTime = top.upTime;
+  std::copy(top.loadAverage, top.loadAverage + 3, frame.loadAverage);
+  frame.sortKey = static_cast<SortKey>(top.sortKey);
+  frame.columns = Columns{};
+  frame.columns.io = false;  // not recorded
+  frame.cores.resize(top.cores);
+  std::memcpy(frame.cores.data(), slot + layout_.cores,
+              sizeof(float) * top.cores);
+
+  auto* pid = reinterpret_cast<const std::int32_t*>(slot + layout_.pid);
+  auto* cpu = reinterpret_cast<const float*>(slot + layout_.cpu);
+  auto column = [slot](std::size_t offset) {
+    return reinterpret_cast<const std::int64_t*>(slot + offset);
+  };
+  auto* rssMb = column(layout_.rssMb);
+  auto* pssMb = column(layout_.pssMb);
+  auto* sharedMb = column(layout_.sharedMb);
+  auto* privateMb = column(layout_.privateMb);
+  auto* swapMb = column(layout_.swapMb);
+  auto* upTime = column(layout_.upTime);
+  const char* user = slot + layout_.user;
+  const char* command = slot + layout_.command;
+  frame.rows.resize(top.rows);
+  for (size_t i{0}; i < top.rows; ++i) {
+    ProcessRow& row = frame.rows[i];
+    row.pid = pid[i];
+    row.cpu = cpu[i];
+    row.rssMb = static_cast<long>(rssMb[i]);
+    row.pssMb = static_cast<long>(pssMb[i]);
+    row.sharedMb = static_cast<long>(sharedMb[i]);
+    row.privateMb = static_cast<long>(privateMb[i]);
+    row.swapMb = static_cast<long>(swapMb[i]);
+    row.readKbPerSecond = row.writeKbPerSecond = -1;  // not recorded
+    row.readCallsPerSecond = row.writeCallsPerSecond = -1;
+    row.upTime = static_cast<long>(upTime[i]);
+    std::snprintf(row.user, sizeof(row.user), "%.*s",
+                  static_cast<int>(kUserLength - 1), user + i * kUserLength);
+    std::snprintf(row.command, sizeof(row.command), "%.*s",
+                  static_cast<int>(kCommandLength - 1),
+                  command + i * kCommandLength);
+  }
+  // Appending sequence + capacity reuses the slot, and starts before
+  // written reaches it
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return Written() < sequence + h->capacity;
+}
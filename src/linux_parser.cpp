@@ -1,8 +1,22 @@
 #include "../include/linux_parser.h"
 #include "../include/format.h"
+#include "../include/parse_util.h"
+#include "../include/profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <dirent.h>
+#include <fcntl.h>
+#include <iterator>
+#include <limits.h>
+#include <mutex>
+#include <pwd.h>
+#include <sstream>
 #include <string>
+#include <sys/stat.h>
 #include <unistd.h>
+#include <unordered_map>
 #include <vector>
 
 using std::stof;
@@ -10,9 +24,162 @@ using std::string;
 using std::to_string;
 using std::vector;
 
+namespace {
+struct Paths {
+  string root;
+  string procDirectory{LinuxParser::kProcDirectory};
+  string osPath{LinuxParser::kOSPath};
+  string passwordPath{LinuxParser::kPasswordPath};
+  string cgroupDirectory{LinuxParser::kCgroupDirectory};
+};
+
+Paths &CurrentPaths() {
+  static Paths paths;
+  return paths;
+}
+}  // namespace
+
+// A trailing slash on root is dropped, so "fake/" and "fake" are the same
+void LinuxParser::SetRoot(const string &root) {
+  Paths &paths = CurrentPaths();
+  paths.root = root;
+  while (!paths.root.empty() && paths.root.back() == '/') {
+    paths.root.pop_back();
+  }
+  paths.procDirectory = paths.root + kProcDirectory;
+  paths.osPath = paths.root + kOSPath;
+  paths.passwordPath = paths.root + kPasswordPath;
+  paths.cgroupDirectory = paths.root + kCgroupDirectory;
+}
+
+const string &LinuxParser::Root() { return CurrentPaths().root; }
+
+const string &LinuxParser::ProcDirectory() {
+  return CurrentPaths().procDirectory;
+}
+
+const string &LinuxParser::OSPath() { return CurrentPaths().osPath; }
+
+const string &LinuxParser::PasswordPath() {
+  return CurrentPaths().passwordPath;
+}
+
+const string &LinuxParser::CgroupDirectory() {
+  return CurrentPaths().cgroupDirectory;
+}
+
+// Reads path with a single read() into the caller's buffer. Returns the
+// number of bytes read, 0 if the file is gone.
+static std::size_t ReadPath(const char *path, char *buffer,
+                            std::size_t size) {
+  Profiler::CountSyscalls();
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return 0;
+  }
+
+  Profiler::CountSyscalls(2);
+  ssize_t length = read(fd, buffer, size);
+  close(fd);
+  return length > 0 ? static_cast<std::size_t>(length) : 0;
+}
+
+// Reads /proc/[pid]/<filename> with a single read() into the caller's
+// buffer. Returns the number of bytes read, 0 if the process is gone.
+static std::size_t ReadPidFile(int pid, const string &filename, char *buffer,
+                               std::size_t size) {
+  char path[PATH_MAX];
+  std::snprintf(path, sizeof(path), "%s%d%s",
+                LinuxParser::ProcDirectory().c_str(), pid, filename.c_str());
+  return ReadPath(path, buffer, size);
+}
+
+// Refills numbers with the entries of directory whose names are all
+// digits, like the pids of /proc. Names are checked and converted without
+// building strings. Returns false if the directory cannot be opened.
+static bool ReadNumberedDirectory(const char *path, vector<int> &numbers) {
+  numbers.clear();
+  Profiler::CountSyscalls(3);  // open, fstat and close; not the listing
+  DIR *directory = opendir(path);
+  if (directory == nullptr) {
+    return false;
+  }
+
+  struct dirent *file;
+  while ((file = readdir(directory)) != nullptr) {
+    // Is every character of the name a digit?
+    int number{0};
+    const char *c = file->d_name;
+    for (; ParseUtil::IsDigit(*c); ++c) {
+      number = number * 10 + (*c - '0');
+    }
+    if (*c != '\0' || c == file->d_name) {
+      continue;
+    }
+
+    // Is this a directory? Checked after the name, so only numbered
+    // entries are ever stat'ed.
+    if (LinuxParser::IsDirectory(dirfd(directory), file->d_name,
+                                 file->d_type)) {
+      numbers.push_back(number);
+    }
+  }
+  closedir(directory);
+  return true;
+}
+
+// Filesystems that do not fill in d_type, like some network and overlay
+// ones, report DT_UNKNOWN for every entry
+bool LinuxParser::IsDirectory(int directoryFd, const char *name,
+                              unsigned char type) {
+  if (type != DT_UNKNOWN) {
+    return type == DT_DIR;
+  }
+  Profiler::CountSyscalls();
+  struct stat status;
+  return fstatat(directoryFd, name, &status, AT_SYMLINK_NOFOLLOW) == 0 &&
+         S_ISDIR(status.st_mode);
+}
+
+// Reads the whole file into buffer, growing it only when the file does not
+// fit. Returns the number of bytes read, 0 if the file could not be read.
+std::size_t LinuxParser::ReadFile(const string &filename,
+                                  vector<char> &buffer) {
+  Profiler::CountSyscalls();
+  int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    perror(("error while opening the file " + filename).c_str());
+    return 0;
+  }
+
+  if (buffer.empty()) {
+    buffer.resize(4096);
+  }
+  std::size_t length{0};
+  while (true) {
+    if (length == buffer.size()) {
+      buffer.resize(buffer.size() * 2);
+    }
+    Profiler::CountSyscalls();
+    ssize_t count = read(fd, buffer.data() + length, buffer.size() - length);
+    if (count < 0) {
+      perror(("error while reading file " + filename).c_str());
+      length = 0;
+      break;
+    }
+    if (count == 0) {
+      break;
+    }
+    length += static_cast<std::size_t>(count);
+  }
+  Profiler::CountSyscalls();
+  close(fd);
+  return length;
+}
+
 // DONE: An example of how to read data from the filesystem
 string LinuxParser::OperatingSystem() {
-  string filename{kOSPath};
+  string filename{OSPath()};
   std::ifstream stream(filename);
 
   if (!stream.is_open()) {
@@ -45,7 +212,7 @@ string LinuxParser::OperatingSystem() {
 
 // DONE: An example of how to read data from the filesystem
 string LinuxParser::Kernel() {
-  string filename{kProcDirectory + kVersionFilename};
+  string filename{ProcDirectory() + kVersionFilename};
   std::ifstream stream(filename);
 
   if (!stream.is_open()) {
@@ -70,28 +237,30 @@ string LinuxParser::Kernel() {
 // BONUS: Update this to use std::filesystem
 vector<int> LinuxParser::Pids() {
   vector<int> pids;
-  DIR *directory = opendir(kProcDirectory.c_str());
-  struct dirent *file;
-  while ((file = readdir(directory)) != nullptr) {
-    // Is this a directory?
+  Pids(pids);
+  return pids;
+}
 
-    if (file->d_type == DT_DIR) {
-      // Is every character of the name a digit?
-      string filename(file->d_name);
+// Refills pids in place so its capacity is reused from one refresh to the
+// next
+void LinuxParser::Pids(vector<int> &pids) {
+  if (!ReadNumberedDirectory(ProcDirectory().c_str(), pids)) {
+    perror(("error while opening the directory " + ProcDirectory()).c_str());
+  }
+}
 
-      if (std::all_of(filename.begin(), filename.end(), isdigit)) {
-        int pid = stoi(filename);
-        pids.push_back(pid);
-      }
-    }
-  }  
-  closedir(directory);
-  return pids;
+// Refills tids with the threads of pid, the process itself included.
+// Returns false, without reporting it, if the process is gone.
+bool LinuxParser::Tasks(int pid, vector<int> &tids) {
+  char path[PATH_MAX];
+  std::snprintf(path, sizeof(path), "%s%d%s", ProcDirectory().c_str(), pid,
+                kTaskDirectory.c_str());
+  return ReadNumberedDirectory(path, tids);
 }
 
 // TODO: Read and return the system memory utilization
 float LinuxParser::MemoryUtilization() {
-  string filename{kProcDirectory + kMeminfoFilename};
+  string filename{ProcDirectory() + kMeminfoFilename};
   std::ifstream stream(filename);
 
   if (!stream.is_open()) {
@@ -136,7 +305,7 @@ float LinuxParser::MemoryUtilization() {
 
 // TODO: Read and return the system uptime
 long LinuxParser::UpTime() {
-  string filename{kProcDirectory + kUptimeFilename};
+  string filename{ProcDirectory() + kUptimeFilename};
   std::ifstream stream(filename);
 
   if (!stream.is_open()) {
@@ -166,41 +335,18 @@ long LinuxParser::Jiffies() {
 
 // TODO: Read and return the number of active jiffies for a PID
 float LinuxParser::ActiveJiffies(int pid) {
-  string filename{kProcDirectory + to_string(pid) + kStatFilename};
-  std::ifstream stream(filename);
-
-  if (!stream.is_open()) {
-    perror(("error while opening the file " + filename).c_str());
-  }
-
-  string line{};
-  float cpuUsage{};
-  while (getline(stream, line)) {
-    std::istringstream buf(line);
-    std::istream_iterator<string> beg(buf), end;
-    vector<string> values(beg, end);
-    long uTime = stol(
-        values[13]); // CPU time spent in user code, measured in clock ticks
-    long sTime = stol(
-        values[14]); // CPU time spent in kernel code, measured in clock ticks
-    long cuTime = stol(values[15]); // Waited-for children's CPU time spent in
-                                    // user code (in clock ticks)
-    long csTime = stol(values[16]); // Waited-for children's CPU time spent in
-                                    // kernel code (in clock ticks)
-    long startTime = stol(
-        values[21]); // Time when the process started, measured in clock ticks
-    long hertz{sysconf(_SC_CLK_TCK)};
-
-    long totalTime = uTime + sTime + cuTime + csTime;
-    long seconds = UpTime() - (startTime / hertz);
-    cpuUsage = ((1.0 * totalTime) / hertz) / seconds;
+  ProcStatRecord record;
+  if (!ParseProcStat(pid, record)) {
+    return 0.0;
   }
 
-  if (stream.bad()) {
-    perror(("error while reading file " + filename).c_str());
-    stream.close();
+  long hertz{sysconf(_SC_CLK_TCK)};
+  long totalTime = record.utime + record.stime + record.cutime + record.cstime;
+  long seconds = UpTime() - static_cast<long>(record.startTime / hertz);
+  if (seconds <= 0) {
+    return 0.0;
   }
-  return cpuUsage;
+  return ((1.0 * totalTime) / hertz) / seconds;
 }
 
 // TODO: Read and return the number of active jiffies for the system
@@ -227,7 +373,7 @@ long LinuxParser::IdleJiffies() {
 
 // TODO: Read and return CPU utilization
 vector<string> LinuxParser::CpuUtilization() {
-  string filename{kProcDirectory + kStatFilename};
+  string filename{ProcDirectory() + kStatFilename};
   std::ifstream stream(filename);
 
   if (!stream.is_open()) {
@@ -255,7 +401,7 @@ vector<string> LinuxParser::CpuUtilization() {
 
 // TODO: Read and return the total number of processes
 int LinuxParser::TotalProcesses() {
-  string filename{kProcDirectory + kStatFilename};
+  string filename{ProcDirectory() + kStatFilename};
   std::ifstream stream(filename);
 
   if (!stream.is_open()) {
@@ -283,7 +429,7 @@ int LinuxParser::TotalProcesses() {
 
 // TODO: Read and return the number of running processes
 int LinuxParser::RunningProcesses() {
-  string filename{kProcDirectory + kStatFilename};
+  string filename{ProcDirectory() + kStatFilename};
   std::ifstream stream(filename);
 
   if (!stream.is_open()) {
@@ -311,32 +457,49 @@ int LinuxParser::RunningProcesses() {
 
 // TODO: Read and return the command associated with a process
 string LinuxParser::Command(int pid) {
-  string filename{kProcDirectory + to_string(pid) + kCmdlineFilename};
-  std::ifstream stream(filename);
-
-  if (!stream.is_open()) {
-    perror(("error while opening the file " + filename).c_str());
-  }
+  char buffer[4096];
+  std::size_t length = Command(pid, buffer, sizeof(buffer));
+  return string(buffer, length);
+}
 
-  string line{};
-  string command{};
-  while (std::getline(stream, line)) {
-    std::istringstream buf(line);
-    std::istream_iterator<string> beg(buf), end;
-    vector<string> values(beg, end);
-    command = values[0];
+// The first word of the command line, whose arguments are NUL separated,
+// left at the start of buffer. Returns its length, 0 for kernel threads
+// and zombies, which have no command line.
+std::size_t LinuxParser::Command(int pid, char *buffer, std::size_t size) {
+  std::size_t length = ReadPidFile(pid, kCmdlineFilename, buffer, size);
+  const char *end = buffer;
+  while (end < buffer + length && *end != '\0' && !ParseUtil::IsSpace(*end)) {
+    ++end;
   }
+  return static_cast<std::size_t>(end - buffer);
+}
 
-  if (stream.bad()) {
-    perror(("error while reading file " + filename).c_str());
-    stream.close();
-  }
-  return command;
+// The cgroup v2 path of the process, the "0::" line of /proc/[pid]/cgroup,
+// left at the start of buffer. Returns its length, 0 if the process is
+// gone or is in no v2 hierarchy.
+std::size_t LinuxParser::ProcCgroup(int pid, char *buffer, std::size_t size) {
+  std::size_t length = ReadPidFile(pid, kCgroupFilename, buffer, size);
+  const char *p = buffer;
+  const char *end = buffer + length;
+  while (p < end && !ParseUtil::StartsWith(p, end, "0::")) {
+    p = ParseUtil::SkipLine(p, end);
+  }
+  if (p >= end) {
+    return 0;
+  }
+  p += 3;
+  const char *newline = static_cast<const char *>(
+      std::memchr(p, '\n', static_cast<std::size_t>(end - p)));
+  std::size_t path = static_cast<std::size_t>((newline ? newline : end) - p);
+  std::memmove(buffer, p, path);
+  return path;
 }
 
 // TODO: Read and return the memory used by a process
+// The resident set in MB; VmSize counts address space that was never
+// touched
 string LinuxParser::Ram(int pid) {
-  string filename{kProcDirectory + to_string(pid) + kStatusFilename};
+  string filename{ProcDirectory() + to_string(pid) + kStatusFilename};
   std::ifstream stream(filename);
 
   if (!stream.is_open()) {
@@ -350,8 +513,8 @@ string LinuxParser::Ram(int pid) {
     std::istream_iterator<string> beg(buf), end;
     vector<string> values(beg, end);
 
-    if (values[0] == "VmSize:") {
-      ramMemory = stoi(values[1]) / 1000;
+    if (values[0] == "VmRSS:") {
+      ramMemory = stoi(values[1]) / 1024;
     }
   }
 
@@ -365,7 +528,7 @@ string LinuxParser::Ram(int pid) {
 
 // TODO: Read and return the user ID associated with a process
 string LinuxParser::Uid(int pid) {
-  string filename{kProcDirectory + to_string(pid) + kStatusFilename};
+  string filename{ProcDirectory() + to_string(pid) + kStatusFilename};
   std::ifstream stream(filename);
 
   if (!stream.is_open()) {
@@ -393,58 +556,418 @@ string LinuxParser::Uid(int pid) {
 
 // TODO: Read and return the user associated with a process
 string LinuxParser::User(int pid) {
-  string filename{kPasswordPath};
-  std::ifstream stream(filename);
-
-  if (!stream.is_open()) {
-    perror(("error while opening the file " + filename).c_str());
-  }
-
-  string line{};
-  string result{};
   string uid{Uid(pid)};
-  while (getline(stream, line)) {
-    std::istringstream buf(line);
-    std::istream_iterator<string> beg(buf), end;
-    vector<string> values(beg, end);
+  if (uid.empty()) {
+    return string{};
+  }
+  return UserName(stoi(uid));
+}
 
-    std::string p{":"};
-    std::string stringToSearch{p + uid + p};
-    int pPosition = values[0].find_first_of(stringToSearch);
+namespace {
+// uid -> name map of the password file, shared by the whole process.
+// It is rebuilt only when the file is replaced or modified, which is
+// checked at most once per kUserCacheCheckInterval.
+struct UserCache {
+  std::mutex mutex;
+  std::unordered_map<int, string> names;
+  dev_t device{};
+  ino_t inode{};
+  struct timespec modified {};
+  bool loaded{false};
+  std::chrono::steady_clock::time_point lastCheck{};
+};
+
+const std::chrono::seconds kUserCacheCheckInterval{1};
+
+UserCache &Users() {
+  static UserCache cache;
+  return cache;
+}
 
-    if (values[0].find_first_of(stringToSearch) != std::string::npos) {
-      result = values[0].substr(0, pPosition);
-      break;
+// Format is name:password:uid:gid:gecos:home:shell
+void LoadPasswordFile(UserCache &cache, const string &filename) {
+  cache.names.clear();
+  vector<char> buffer;
+  std::size_t length = LinuxParser::ReadFile(filename, buffer);
+  const char *p = buffer.data();
+  const char *end = p + length;
+  while (p < end) {
+    const char *lineEnd = ParseUtil::SkipLine(p, end);
+    const char *nameEnd =
+        static_cast<const char *>(std::memchr(p, ':', lineEnd - p));
+    const char *uidBegin =
+        nameEnd ? static_cast<const char *>(
+                      std::memchr(nameEnd + 1, ':', lineEnd - nameEnd - 1))
+                : nullptr;
+    if (uidBegin != nullptr) {
+      long long uid{};
+      ParseUtil::ParseLong(uidBegin + 1, lineEnd, uid);
+      cache.names.emplace(static_cast<int>(uid), string(p, nameEnd));
+    }
+    p = lineEnd;
+  }
+}
+}  // namespace
+
+// Looks the uid up in the cached password file. Users that only exist in
+// other NSS sources fall back to getpwuid_r(), and unknown uids are shown
+// numerically; both results are cached as well.
+string LinuxParser::UserName(int uid) {
+  UserCache &cache = Users();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+
+  auto now = std::chrono::steady_clock::now();
+  if (!cache.loaded || now - cache.lastCheck >= kUserCacheCheckInterval) {
+    cache.lastCheck = now;
+    struct stat info {};
+    if (stat(PasswordPath().c_str(), &info) == 0 &&
+        (!cache.loaded || info.st_dev != cache.device ||
+         info.st_ino != cache.inode ||
+         info.st_mtim.tv_sec != cache.modified.tv_sec ||
+         info.st_mtim.tv_nsec != cache.modified.tv_nsec)) {
+      LoadPasswordFile(cache, PasswordPath());
+      cache.device = info.st_dev;
+      cache.inode = info.st_ino;
+      cache.modified = info.st_mtim;
     }
+    cache.loaded = true;
   }
 
-  if (stream.bad()) {
-    perror(("error while reading file " + filename).c_str());
-    stream.close();
+  auto found = cache.names.find(uid);
+  if (found != cache.names.end()) {
+    return found->second;
+  }
+
+  struct passwd entry {};
+  struct passwd *result{nullptr};
+  char buffer[1024];
+  string name{to_string(uid)};
+  if (getpwuid_r(static_cast<uid_t>(uid), &entry, buffer, sizeof(buffer),
+                 &result) == 0 &&
+      result != nullptr) {
+    name = result->pw_name;
   }
-  return result;
+  cache.names.emplace(uid, name);
+  return name;
 }
 
 // TODO: Read and return the uptime of a process
 long LinuxParser::UpTime(int pid) {
-  string filename{kProcDirectory + to_string(pid) + kStatFilename};
-  std::ifstream stream(filename);
+  ProcStatRecord record;
+  if (!ParseProcStat(pid, record)) {
+    return 0;
+  }
+  return UpTime() - static_cast<long>(record.startTime / sysconf(_SC_CLK_TCK));
+}
 
-  if (!stream.is_open()) {
-    perror(("error while opening the file " + filename).c_str());
+// Reads /proc/[pid]/stat into a stack buffer and parses it in place.
+// Returns false if the process is gone or the file is malformed.
+bool LinuxParser::ParseProcStat(int pid, ProcStatRecord &record) {
+  char buffer[2048];
+  std::size_t length = ReadPidFile(pid, kStatFilename, buffer, sizeof(buffer));
+  return length > 0 && ParseProcStat(buffer, length, record);
+}
+
+// Like ParseProcStat(), for one thread of pid, and with the CPU the
+// thread last ran on
+bool LinuxParser::ParseTaskStat(int pid, int tid, ProcStatRecord &record) {
+  char path[PATH_MAX];
+  std::snprintf(path, sizeof(path), "%s%d%s%d%s", ProcDirectory().c_str(),
+                pid, kTaskDirectory.c_str(), tid, kStatFilename.c_str());
+  char buffer[2048];
+  std::size_t length = ReadPath(path, buffer, sizeof(buffer));
+  return length > 0 && ParseProcStat(buffer, length, record, 39);
+}
+
+// The comm field may itself contain blanks and parentheses, so it runs from
+// the first '(' to the last ')' of the line. Everything after is numeric.
+// Parsing stops after lastField, at least 24: the fields up to there are
+// all a full scan needs, the ones after are mostly addresses. A pid or
+// parsed field without digits, as in a truncated or garbled line, makes
+// the whole record invalid rather than a row of zeros.
+bool LinuxParser::ParseProcStat(const char *data, std::size_t length,
+                                ProcStatRecord &record, int lastField) {
+  const char *end = data + length;
+  const char *commBegin =
+      static_cast<const char *>(std::memchr(data, '(', length));
+  const char *commEnd = end;
+  while (commEnd > data && *(commEnd - 1) != ')') --commEnd;
+  if (commBegin == nullptr || commEnd <= commBegin) {
+    return false;
+  }
+  --commEnd;  // the ')' itself
+
+  long long value{};
+  if (ParseUtil::ParseLong(data, commBegin, value) == data) {
+    return false;
+  }
+  record.pid = static_cast<int>(value);
+  std::size_t commLength = std::min<std::size_t>(commEnd - commBegin - 1,
+                                                 sizeof(record.comm) - 1);
+  std::memcpy(record.comm, commBegin + 1, commLength);
+  record.comm[commLength] = '\0';
+
+  const char *p = ParseUtil::SkipSpaces(commEnd + 1, end);
+  if (p == end) {
+    return false;
+  }
+  record.state = *p;
+  p = ParseUtil::SkipToken(p, end);
+
+  int field{4};
+  lastField = std::max(lastField, 24);
+  for (; field <= lastField && p < end; ++field) {
+    // Fields 25 to 38 hold values up to 2^64 - 1, like rsslim
+    if (field > 24 && field < 39) {
+      p = ParseUtil::SkipToken(p, end);
+      continue;
+    }
+    const char *next = ParseUtil::ParseLong(p, end, value);
+    if (next == p) {
+      return false;
+    }
+    p = next;
+    switch (field) {
+      case 4: record.ppid = static_cast<int>(value); break;
+      case 14: record.utime = static_cast<long>(value); break;
+      case 15: record.stime = static_cast<long>(value); break;
+      case 16: record.cutime = static_cast<long>(value); break;
+      case 17: record.cstime = static_cast<long>(value); break;
+      case 20: record.numThreads = static_cast<long>(value); break;
+      case 22: record.startTime = static_cast<unsigned long long>(value); break;
+      case 24: record.rss = static_cast<long>(value); break;
+      case 39: record.processor = static_cast<int>(value); break;
+      default: break;
+    }
+    p = ParseUtil::SkipSpaces(p, end);
   }
-  string line{};
-  string startTime{};
-  while (getline(stream, line)) {
-    std::istringstream buf(line);
-    std::istream_iterator<string> beg(buf), end;
-    vector<string> values(beg, end);
-    startTime = values[21];
+  return field > lastField;
+}
+
+// Reads /proc/[pid]/status into a stack buffer and parses it in place.
+// Returns false if the process is gone.
+bool LinuxParser::ParseProcStatus(int pid, ProcStatusRecord &record) {
+  char buffer[4096];
+  std::size_t length =
+      ReadPidFile(pid, kStatusFilename, buffer, sizeof(buffer));
+  return length > 0 && ParseProcStatus(buffer, length, record);
+}
+
+// Kernel threads have no Vm* lines, their fields are left at zero
+bool LinuxParser::ParseProcStatus(const char *data, std::size_t length,
+                                  ProcStatusRecord &record) {
+  const char *p = data;
+  const char *end = data + length;
+  long long value{};
+  record.vmSwap = 0;
+  record.uid = -1;
+  int found{0};
+  while (p < end && found < 2) {
+    if (ParseUtil::StartsWith(p, end, "Uid:")) {
+      p = ParseUtil::ParseLong(p + 4, end, value);  // the real uid
+      record.uid = static_cast<int>(value);
+      ++found;
+    } else if (ParseUtil::StartsWith(p, end, "VmSwap:")) {
+      p = ParseUtil::ParseLong(p + 7, end, value);
+      record.vmSwap = static_cast<long>(value);
+      ++found;
+    }
+    p = ParseUtil::SkipLine(p, end);
   }
+  return true;
+}
 
-  if (stream.bad()) {
-    perror(("error while reading file " + filename).c_str());
-    stream.close();
+// Returns false if the process is gone, is a kernel thread, whose file
+// is empty, or its memory may not be read, which takes ptrace rights
+bool LinuxParser::ParseSmapsRollup(int pid, SmapsRollupRecord &record) {
+  char buffer[4096];
+  std::size_t length =
+      ReadPidFile(pid, kSmapsRollupFilename, buffer, sizeof(buffer));
+  return length > 0 && ParseSmapsRollup(buffer, length, record);
+}
+
+// The first line is the address range, the rest "Name:   value kB"
+bool LinuxParser::ParseSmapsRollup(const char *data, std::size_t length,
+                                   SmapsRollupRecord &record) {
+  const char *p = ParseUtil::SkipLine(data, data + length);
+  const char *end = data + length;
+  long long value{};
+  record = SmapsRollupRecord{};
+  while (p < end) {
+    const char *colon = static_cast<const char *>(
+        std::memchr(p, ':', static_cast<std::size_t>(end - p)));
+    if (colon == nullptr) {
+      break;
+    }
+    const char *name = p;
+    std::size_t nameLength = static_cast<std::size_t>(colon - p);
+    p = ParseUtil::ParseLong(colon + 1, end, value);
+    long kb = static_cast<long>(value);
+    auto is = [name, nameLength](const char *field) {
+      return nameLength == std::strlen(field) &&
+             std::memcmp(name, field, nameLength) == 0;
+    };
+    if (is("Rss")) {
+      record.rss = kb;
+    } else if (is("Pss")) {
+      record.pss = kb;
+    } else if (is("Shared_Clean") || is("Shared_Dirty")) {
+      record.shared += kb;
+    } else if (is("Private_Clean") || is("Private_Dirty")) {
+      record.private_ += kb;
+    } else if (is("Swap")) {
+      record.swap = kb;
+    }
+    p = ParseUtil::SkipLine(p, end);
+  }
+  return true;
+}
+
+// Returns false if the process is gone, or its counters may not be read,
+// which takes the same rights as ptrace. Both are common enough that
+// neither is reported.
+bool LinuxParser::ParseProcIo(int pid, ProcIoRecord &record) {
+  char buffer[512];
+  std::size_t length = ReadPidFile(pid, kIoFilename, buffer, sizeof(buffer));
+  return length > 0 && ParseProcIo(buffer, length, record);
+}
+
+// "name: value" lines; rchar, wchar and cancelled_write_bytes are not
+// needed
+bool LinuxParser::ParseProcIo(const char *data, std::size_t length,
+                              ProcIoRecord &record) {
+  const char *p = data;
+  const char *end = data + length;
+  int found{0};
+  while (p < end && found < 4) {
+    if (ParseUtil::StartsWith(p, end, "syscr:")) {
+      p = ParseUtil::ParseLong(p + 6, end, record.syscr);
+      ++found;
+    } else if (ParseUtil::StartsWith(p, end, "syscw:")) {
+      p = ParseUtil::ParseLong(p + 6, end, record.syscw);
+      ++found;
+    } else if (ParseUtil::StartsWith(p, end, "read_bytes:")) {
+      p = ParseUtil::ParseLong(p + 11, end, record.readBytes);
+      ++found;
+    } else if (ParseUtil::StartsWith(p, end, "write_bytes:")) {
+      p = ParseUtil::ParseLong(p + 12, end, record.writeBytes);
+      ++found;
+    }
+    p = ParseUtil::SkipLine(p, end);
+  }
+  return found == 4;
+}
+
+// cpu.stat counts in microseconds; throttled_usec is only there when the
+// cpu controller is enabled for the group
+bool LinuxParser::ParseCgroupCpuStat(const char *data, std::size_t length,
+                                     CgroupRecord &record) {
+  const char *p = data;
+  const char *end = data + length;
+  while (p < end) {
+    if (ParseUtil::StartsWith(p, end, "usage_usec ")) {
+      p = ParseUtil::ParseLong(p + 11, end, record.usageUsec);
+    } else if (ParseUtil::StartsWith(p, end, "throttled_usec ")) {
+      p = ParseUtil::ParseLong(p + 15, end, record.throttledUsec);
+    }
+    p = ParseUtil::SkipLine(p, end);
+  }
+  return length > 0;
+}
+
+// Only the anon and file lines, which come first, are read
+bool LinuxParser::ParseCgroupMemoryStat(const char *data, std::size_t length,
+                                        CgroupRecord &record) {
+  const char *p = data;
+  const char *end = data + length;
+  int found{0};
+  while (p < end && found < 2) {
+    if (ParseUtil::StartsWith(p, end, "anon ")) {
+      p = ParseUtil::ParseLong(p + 5, end, record.anon);
+      ++found;
+    } else if (ParseUtil::StartsWith(p, end, "file ")) {
+      p = ParseUtil::ParseLong(p + 5, end, record.file);
+      ++found;
+    }
+    p = ParseUtil::SkipLine(p, end);
   }
-  return UpTime() - (stol(startTime) / sysconf(_SC_CLK_TCK));
-}
\ No newline at end of file
+  return length > 0;
+}
+
+// One line per device, "MAJ:MIN rbytes=N wbytes=N rios=N ...", summed
+bool LinuxParser::ParseCgroupIoStat(const char *data, std::size_t length,
+                                    CgroupRecord &record) {
+  const char *p = data;
+  const char *end = data + length;
+  long long value{};
+  record.readBytes = 0;
+  record.writeBytes = 0;
+  while (p < end) {
+    const char *line = ParseUtil::SkipLine(p, end);
+    for (p = ParseUtil::SkipToken(p, line); p < line;
+         p = ParseUtil::SkipToken(p, line)) {
+      if (ParseUtil::StartsWith(p, line, "rbytes=")) {
+        p = ParseUtil::ParseLong(p + 7, line, value);
+        record.readBytes += value;
+      } else if (ParseUtil::StartsWith(p, line, "wbytes=")) {
+        p = ParseUtil::ParseLong(p + 7, line, value);
+        record.writeBytes += value;
+      }
+    }
+    p = line;
+  }
+  return true;
+}
+
+// "MAJ MIN name" and then the counters; newer kernels add discard and
+// flush counters, which are not read. Returns the start of the next line,
+// with record.name empty if the line was not a device.
+const char *LinuxParser::ParseDiskstatsLine(const char *p, const char *end,
+                                            DiskRecord &record) {
+  const char *line = ParseUtil::SkipLine(p, end);
+  long long value{};
+  p = ParseUtil::ParseLong(p, line, value);
+  record.major = static_cast<int>(value);
+  p = ParseUtil::ParseLong(p, line, value);
+  record.minor = static_cast<int>(value);
+  p = ParseUtil::SkipSpaces(p, line);
+  const char *name = p;
+  while (p < line && !ParseUtil::IsSpace(*p)) ++p;
+  record.name = std::string_view(name, static_cast<std::size_t>(p - name));
+  long long *fields[] = {&record.reads,        nullptr,
+                         &record.readSectors,  nullptr,
+                         &record.writes,       nullptr,
+                         &record.writeSectors, nullptr,
+                         &record.inFlight,     &record.ioTicks,
+                         &record.weightedTicks};
+  for (long long *field : fields) {
+    p = ParseUtil::ParseLong(p, line, field != nullptr ? *field : value);
+  }
+  return line;
+}
+
+// "  name: rx bytes, packets, errs, drop, fifo, frame, compressed,
+// multicast, then tx bytes, packets, errs, drop, ..."; the two header
+// lines, which have no colon, leave record.name empty
+const char *LinuxParser::ParseNetDevLine(const char *p, const char *end,
+                                         NetRecord &record) {
+  const char *line = ParseUtil::SkipLine(p, end);
+  p = ParseUtil::SkipSpaces(p, line);
+  const char *colon = static_cast<const char *>(
+      std::memchr(p, ':', static_cast<std::size_t>(line - p)));
+  if (colon == nullptr) {
+    record.name = {};
+    return line;
+  }
+  record.name = std::string_view(p, static_cast<std::size_t>(colon - p));
+  long long value{};
+  long long *fields[] = {&record.rxBytes, &record.rxPackets, nullptr,
+                         &record.rxDrops, nullptr,           nullptr,
+                         nullptr,         nullptr,           &record.txBytes,
+                         &record.txPackets, nullptr,         &record.txDrops};
+  p = colon + 1;
+  for (long long *field : fields) {
+    p = ParseUtil::ParseLong(p, line, field != nullptr ? *field : value);
+  }
+  return line;
+}
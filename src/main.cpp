@@ -1,7 +1,59 @@
+#include <unistd.h>
+
+#include <cstdio>
+
+#include "../include/headless.h"
+#include "../include/history_ring.h"
+#include "../include/linux_parser.h"
 #include "../include/ncurses_display.h"
+#include "../include/options.h"
 #include "../include/system.h"
 
-int main() {
-  System system;
-  NCursesDisplay::Display(system);
-}
\ No newline at end of file
+int main(int argc, char* argv[]) {
+  Options options;
+  if (!CommandLine::Parse(argc, argv, options)) {
+    CommandLine::Usage(argv[0]);
+    return 2;
+  }
+
+  if (!options.replay.empty()) {
+    HistoryRing history;
+    if (!history.Open(options.replay)) {
+      return 1;
+    }
+    NCursesDisplay::Replay(history, options.top);
+    return 0;
+  }
+
+  LinuxParser::SetRoot(options.root);
+  System system(options.threads);
+  system.SetColumns(options.columns);
+  system.SetGroupBy(options.groupBy);
+  system.SetTreeView(options.tree);
+  system.SetThreadView(options.threadView);
+  system.SetThreadPid(options.threadPid);
+  // The proc connector reports the live kernel's processes, not the root's
+  if (options.netlink && !options.root.empty()) {
+    std::fprintf(stderr, "--netlink ignored with --root\n");
+  } else if (options.netlink && !system.UseProcConnector()) {
+    perror("proc connector unavailable, scanning /proc instead");
+  }
+
+  HistoryRing history;
+  HistoryRing* recorder{nullptr};
+  if (!options.record.empty()) {
+    std::size_t slots = options.recordSlots > 0
+                            ? static_cast<std::size_t>(options.recordSlots)
+                            : HistoryRing::kDefaultCapacity;
+    int cores = static_cast<int>(sysconf(_SC_NPROCESSORS_CONF));
+    if (!history.Create(options.record, slots, options.top, cores)) {
+      return 1;
+    }
+    recorder = &history;
+  }
+
+  if (options.headless) {
+    return Headless::Run(system, options, recorder);
+  }
+  NCursesDisplay::Display(system, options.top, recorder);
+}
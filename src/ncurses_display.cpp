@@ -1,111 +1,895 @@
 #include "ncurses_display.h"
 
 #include <curses.h>
+#include <poll.h>
+#include <unistd.h>
 
-#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
 #include <string>
-#include <thread>
 #include <vector>
 
+#include "canvas.h"
+#include "collector.h"
 #include "format.h"
 #include "system.h"
 
 using std::string;
-using std::to_string;
 
 // 50 bars uniformly displayed from 0 - 100 %
 // 2% is one bar(|)
 std::string NCursesDisplay::ProgressBar(float percent) {
-  std::string result{"0%"};
-  int size{50};
-  float bars{percent * size};
+  char buffer[64];
+  ProgressBar(percent, buffer, sizeof(buffer));
+  return buffer;
+}
+
+// Same bar formatted into the caller's buffer; the percentage is cut, not
+// rounded, to one decimal
+void NCursesDisplay::ProgressBar(float percent, char* buffer,
+                                 std::size_t size) {
+  int const bar_size{50};
+  char bars[bar_size + 1];
+  float ticks{percent * bar_size};
+  for (int i{0}; i < bar_size; ++i) {
+    bars[i] = i <= ticks ? '|' : ' ';
+  }
+  bars[bar_size] = '\0';
 
-  for (int i{0}; i < size; ++i) {
-    result += i <= bars ? '|' : ' ';
+  char display[16];
+  if (percent == 1.0) {
+    std::snprintf(display, sizeof(display), " 100");
+  } else {
+    std::snprintf(display, sizeof(display), "%4.1f",
+                  std::trunc(percent * 1000) / 10);
   }
+  std::snprintf(buffer, size, "0%%%s %s/100%%", bars, display);
+}
+
+// Per core bars are laid out in cells of core_cell_width columns:
+// the core number followed by a bracketed bar of core_bar_width ticks
+namespace {
+int const core_cell_width{16};
+int const core_bar_width{10};
+int const system_rows{10};
+
+int CoreColumns(int width) {
+  return std::max(1, (width - 4) / core_cell_width);
+}
+
+void Start() {
+  initscr();             // start ncurses
+  noecho();              // do not print input values
+  cbreak();              // terminate ncurses on ctrl + c
+  start_color();         // enable color
+  curs_set(0);           // hide the cursor
+  keypad(stdscr, TRUE);  // arrow keys for replay
+  init_pair(1, COLOR_YELLOW, COLOR_BLACK);
+  init_pair(2, COLOR_CYAN, COLOR_BLACK);
+  refresh();  // clear the screen now, getch() would later, over the windows
+}
+
+// The system window grows to hold a bar per core, as far as the screen
+// leaves room above the n process rows. n is cut to the rows the screen
+// has room for.
+void CreateWindows(int cores, int& n, WINDOW*& system_window,
+                   WINDOW*& process_window) {
+  n = std::max(1, std::min(n, getmaxy(stdscr) - system_rows - 3));
+  int x_max{getmaxx(stdscr)};
+  int columns{CoreColumns(x_max - 1)};
+  int core_rows{(cores + columns - 1) / columns};
+  core_rows = std::max(0, std::min(core_rows, getmaxy(stdscr) - system_rows -
+                                                  (3 + n)));
+  system_window = newwin(system_rows + core_rows, x_max - 1, 0, 0);
+  process_window = newwin(3 + n, x_max - 1, system_window->_maxy + 1, 0);
+}
 
-  string display{to_string(percent * 100).substr(0, 4)};
-  if (percent < 0.1 || percent == 1.0)
-    display = " " + to_string(percent * 100).substr(0, 3);
-  return result + " " + display + "/100%";
+// Only the fields that changed since the last frame reach the windows
+void Draw(const Frame& frame, Canvas& system, Canvas& processes, int n,
+          int selected = -1) {
+  system.Box();
+  processes.Box();
+  NCursesDisplay::DisplaySystem(frame, system);
+  NCursesDisplay::DisplayProcesses(frame, processes, n, selected);
+  system.Flush();
+  processes.Flush();
+}
+
+// Keys of the tree view: up/down move the selection, scrolling at the
+// edges, page up/down scroll by n lines, space collapses or expands the
+// selected subtree, left collapses and right expands it. Returns false
+// for keys of no meaning to the tree.
+bool TreeKey(const Frame& frame, Collector& collector, int key, int n,
+             int& selected, long& offset) {
+  int rows{static_cast<int>(std::min(frame.rows.size(), frame.tree.size()))};
+  // Past the end after subtrees collapsed, the collector shows the last n
+  offset = std::min(offset, std::max(0L, frame.treeSize - n));
+  long scrolled{offset};
+  switch (key) {
+    case KEY_UP:
+      if (selected > 0) {
+        --selected;
+      } else {
+        scrolled = std::max(0L, offset - 1);
+      }
+      break;
+    case KEY_DOWN:
+      if (selected + 1 < rows) {
+        ++selected;
+      } else if (offset + rows < frame.treeSize) {
+        ++scrolled;
+      }
+      break;
+    case KEY_PPAGE: scrolled = std::max(0L, offset - n); break;
+    case KEY_NPAGE:
+      scrolled = std::max(0L, std::min(offset + n, frame.treeSize - n));
+      break;
+    case ' ':
+    case KEY_LEFT:
+    case KEY_RIGHT:
+      if (selected < rows && frame.tree[selected].children &&
+          (key == ' ' ||
+           frame.tree[selected].collapsed == (key == KEY_RIGHT))) {
+        collector.Toggle(frame.rows[selected].pid);
+      }
+      break;
+    default: return false;
+  }
+  if (scrolled != offset) {
+    offset = scrolled;
+    collector.SetTreeOffset(static_cast<std::size_t>(offset));
+  }
+  return true;
 }
 
-void NCursesDisplay::DisplaySystem(System& system, WINDOW* window) {
+// Sized for the profile: borders, two header rows and a row per phase
+int const profile_rows{Profiler::kPhases + 4};
+int const profile_columns{70};
+
+// The devices panel: borders, then a header row and the busiest disks,
+// then the same for network interfaces
+int const device_panel_rows{5};
+int const device_rows{2 * device_panel_rows + 4};
+int const device_columns{70};
+}  // namespace
+
+// Draws one row of cells per CoreColumns() cores, as many rows as the
+// window was sized for
+void NCursesDisplay::DisplayCores(const std::vector<float>& cores,
+                                  Canvas& canvas, int row) {
+  int columns{CoreColumns(canvas.Width())};
+  int rows{canvas.Height() - system_rows};
+  int shown{std::min(static_cast<int>(cores.size()), rows * columns)};
+  char bar[core_bar_width + 1];
+  for (int core{0}; core < shown; ++core) {
+    int y{row + core / columns};
+    int x{2 + (core % columns) * core_cell_width};
+    float bars{cores[core] * core_bar_width};
+    for (int i{0}; i < core_bar_width; ++i) {
+      bar[i] = i < bars ? '|' : ' ';
+    }
+    bar[core_bar_width] = '\0';
+    canvas.Printf(y, x, 4, A_NORMAL, "%3d[", core);
+    canvas.Put(y, x + 4, core_bar_width, bar, COLOR_PAIR(1));
+    canvas.Put(y, x + 4 + core_bar_width, 1, "]");
+  }
+}
+
+void NCursesDisplay::DisplaySystem(const Frame& frame, Canvas& canvas) {
   int row{0};
-  mvwprintw(window, ++row, 2, ("OS: " + system.OperatingSystem()).c_str());
-  mvwprintw(window, ++row, 2, ("Kernel: " + system.Kernel()).c_str());
-  mvwprintw(window, ++row, 2, "CPU: ");
-  wattron(window, COLOR_PAIR(1));
-  mvwprintw(window, row, 10, "");
-  wprintw(window, ProgressBar(system.Cpu().Utilization()).c_str());
-  wattroff(window, COLOR_PAIR(1));
-  mvwprintw(window, ++row, 2, "Memory: ");
-  wattron(window, COLOR_PAIR(1));
-  mvwprintw(window, row, 10, "");
-  wprintw(window, ProgressBar(system.MemoryUtilization()).c_str());
-  wattroff(window, COLOR_PAIR(1));
-  mvwprintw(window, ++row, 2,
-            ("Total Processes: " + to_string(system.TotalProcesses())).c_str());
-  mvwprintw(
-      window, ++row, 2,
-      ("Running Processes: " + to_string(system.RunningProcesses())).c_str());
-  mvwprintw(window, ++row, 2,
-            ("Up Time: " + Format::ElapsedTime(system.UpTime())).c_str());
-  wrefresh(window);
-}
-
-void NCursesDisplay::DisplayProcesses(std::vector<Process>& processes,
-                                      WINDOW* window, int n) {
+  int width{canvas.Width() - 3};
+  char bar[64];
+  canvas.Printf(++row, 2, width, A_NORMAL, "OS: %s", frame.os);
+  canvas.Printf(++row, 2, width, A_NORMAL, "Kernel: %s", frame.kernel);
+  canvas.Put(++row, 2, 8, "CPU: ");
+  ProgressBar(frame.cpu, bar, sizeof(bar));
+  canvas.Put(row, 10, width - 8, bar, COLOR_PAIR(1));
+  canvas.Put(++row, 2, 8, "Memory: ");
+  ProgressBar(frame.memory, bar, sizeof(bar));
+  canvas.Put(row, 10, width - 8, bar, COLOR_PAIR(1));
+  canvas.Printf(++row, 2, width, A_NORMAL, "Total Processes: %d",
+                frame.totalProcesses);
+  if (frame.shortLivedProcesses > 0) {
+    canvas.Printf(++row, 2, width, A_NORMAL,
+                  "Running Processes: %d   Short-lived: %d",
+                  frame.runningProcesses, frame.shortLivedProcesses);
+  } else {
+    canvas.Printf(++row, 2, width, A_NORMAL, "Running Processes: %d",
+                  frame.runningProcesses);
+  }
+  char time[32];
+  Format::ElapsedTime(frame.upTime, time, sizeof(time));
+  canvas.Printf(++row, 2, width, A_NORMAL, "Up Time: %s", time);
+  canvas.Printf(++row, 2, width, A_NORMAL, "Load Average: %.2f %.2f %.2f",
+                frame.loadAverage[0], frame.loadAverage[1],
+                frame.loadAverage[2]);
+  DisplayCores(frame.cores, canvas, ++row);
+}
+
+// The top groups with their summed CPU and memory, laid out like the
+// process list
+void NCursesDisplay::DisplayGroups(const Frame& frame, Canvas& canvas,
+                                   int n) {
+  int const name_column{2};
+  int const processes_column{26};
+  int const cpu_column{35};
+  int const ram_column{45};
+  SortKey key{frame.sortKey};
+  auto header = [&canvas](int column, bool sorted, const char* title) {
+    attr_t attr = COLOR_PAIR(2) | (sorted ? A_REVERSE : A_NORMAL);
+    canvas.Put(1, column, 9, title, attr);
+  };
+  canvas.Put(1, name_column, processes_column - name_column,
+             frame.groupBy == GroupBy::kUser ? "USER" : "COMMAND",
+             COLOR_PAIR(2));
+  header(processes_column, key != SortKey::kCpu && key != SortKey::kMemory,
+         "PROCS");
+  header(cpu_column, key == SortKey::kCpu, "CPU[%]");
+  header(ram_column, key == SortKey::kMemory, "RSS[MB]");
+  canvas.Put(1, ram_column + 9, canvas.Width(), "");
+  int rows = std::min<int>(n, frame.groups.size());
+  for (int i = 0; i < n; ++i) {
+    int row{2 + i};
+    if (i >= rows) {
+      canvas.Put(row, 1, canvas.Width(), "");
+      continue;
+    }
+    const GroupRow& group = frame.groups[i];
+    canvas.Put(row, name_column, processes_column - name_column, group.name);
+    canvas.Printf(row, processes_column, cpu_column - processes_column,
+                  A_NORMAL, "%d", group.processes);
+    canvas.Printf(row, cpu_column, ram_column - cpu_column, A_NORMAL, "%.1f",
+                  group.cpu * 100);
+    canvas.Printf(row, ram_column, canvas.Width(), A_NORMAL, "%ld",
+                  group.rssMb);
+  }
+}
+
+// The top cgroups by their own counters. Paths too long for their column
+// keep their end, which names the service or container.
+void NCursesDisplay::DisplayCgroups(const Frame& frame, Canvas& canvas,
+                                    int n) {
+  int const path_column{2};
+  int const processes_column{34};
+  int const cpu_column{41};
+  int const memory_column{50};
+  int const read_column{59};
+  int const write_column{71};
+  int const throttled_column{83};
+  SortKey key{frame.sortKey};
+  auto header = [&canvas](int column, int width, bool sorted,
+                          const char* title) {
+    attr_t attr = COLOR_PAIR(2) | (sorted ? A_REVERSE : A_NORMAL);
+    canvas.Put(1, column, width, title, attr);
+  };
+  canvas.Put(1, path_column, processes_column - path_column, "CGROUP",
+             COLOR_PAIR(2));
+  header(processes_column, cpu_column - processes_column,
+         key != SortKey::kCpu && key != SortKey::kMemory &&
+             key != SortKey::kIo,
+         "PROCS");
+  header(cpu_column, memory_column - cpu_column, key == SortKey::kCpu,
+         "CPU[%]");
+  header(memory_column, read_column - memory_column, key == SortKey::kMemory,
+         "MEM[MB]");
+  header(read_column, write_column - read_column, key == SortKey::kIo,
+         "READ[KB/s]");
+  header(write_column, throttled_column - write_column, key == SortKey::kIo,
+         "WRITE[KB/s]");
+  header(throttled_column, canvas.Width(), false, "THROTTLED[%]");
+  int rows = std::min<int>(n, frame.cgroups.size());
+  int const path_width{processes_column - path_column - 1};
+  for (int i = 0; i < n; ++i) {
+    int row{2 + i};
+    if (i >= rows) {
+      canvas.Put(row, 1, canvas.Width(), "");
+      continue;
+    }
+    const CgroupRow& cgroup = frame.cgroups[i];
+    int length = static_cast<int>(std::strlen(cgroup.path));
+    if (length > path_width) {
+      canvas.Printf(row, path_column, processes_column - path_column,
+                    A_NORMAL, "...%s",
+                    cgroup.path + length - (path_width - 3));
+    } else {
+      canvas.Put(row, path_column, processes_column - path_column,
+                 cgroup.path);
+    }
+    canvas.Printf(row, processes_column, cpu_column - processes_column,
+                  A_NORMAL, "%d", cgroup.processes);
+    canvas.Printf(row, cpu_column, memory_column - cpu_column, A_NORMAL,
+                  "%.1f", cgroup.cpu * 100);
+    canvas.Printf(row, memory_column, read_column - memory_column, A_NORMAL,
+                  "%ld", cgroup.memoryMb);
+    canvas.Printf(row, read_column, write_column - read_column, A_NORMAL,
+                  "%ld", cgroup.readKbPerSecond);
+    canvas.Printf(row, write_column, throttled_column - write_column,
+                  A_NORMAL, "%ld", cgroup.writeKbPerSecond);
+    canvas.Printf(row, throttled_column, canvas.Width(), A_NORMAL, "%.1f",
+                  cgroup.throttled * 100);
+  }
+}
+
+// The lines of the process tree, each command indented by its depth and
+// marked - when its subtree is expanded, + when collapsed, with the number
+// of processes it hides. Besides the process' own CPU and RSS, the sums
+// of its subtree, which siblings are sorted by. The selected row is shown
+// in reverse video.
+void NCursesDisplay::DisplayTree(const Frame& frame, Canvas& canvas, int n,
+                                 int selected) {
+  int const pid_column{2};
+  int const user_column{9};
+  int const cpu_column{16};
+  int const ram_column{26};
+  int const tree_cpu_column{35};
+  int const tree_ram_column{44};
+  int const time_column{53};
+  int const command_column{64};
+  SortKey key{frame.sortKey};
+  auto header = [&canvas, key](int column, SortKey sorts, const char* title) {
+    attr_t attr = COLOR_PAIR(2) | (sorts == key ? A_REVERSE : A_NORMAL);
+    canvas.Put(1, column, 8, title, attr);
+  };
+  header(pid_column, SortKey::kPid, "PID");
+  canvas.Put(1, user_column, 7, "USER", COLOR_PAIR(2));
+  canvas.Put(1, cpu_column, 8, "CPU[%]", COLOR_PAIR(2));
+  canvas.Put(1, ram_column, 9, "RSS[MB]", COLOR_PAIR(2));
+  header(tree_cpu_column, SortKey::kCpu, "SUM CPU");
+  header(tree_ram_column, SortKey::kMemory, "SUM RSS");
+  header(time_column, SortKey::kUpTime, "TIME+");
+  canvas.Put(1, command_column, canvas.Width(), "COMMAND", COLOR_PAIR(2));
+  int rows = std::min<int>({n, static_cast<int>(frame.rows.size()),
+                            static_cast<int>(frame.tree.size())});
+  char field[32];
+  char command[320];
+  for (int i = 0; i < n; ++i) {
+    int row{2 + i};
+    if (i >= rows) {
+      canvas.Put(row, 1, canvas.Width(), "");
+      continue;
+    }
+    const ProcessRow& process = frame.rows[i];
+    const TreeRow& line = frame.tree[i];
+    attr_t attr{i == selected ? A_REVERSE : A_NORMAL};
+    canvas.Printf(row, pid_column, user_column - pid_column, attr, "%d",
+                  process.pid);
+    canvas.Printf(row, user_column, cpu_column - user_column, attr, "%.6s",
+                  process.user);
+    canvas.Printf(row, cpu_column, ram_column - cpu_column, attr, "%.1f",
+                  process.cpu * 100);
+    canvas.Printf(row, ram_column, tree_cpu_column - ram_column, attr,
+                  "%ld", process.rssMb);
+    canvas.Printf(row, tree_cpu_column, tree_ram_column - tree_cpu_column,
+                  attr, "%.1f", line.cpu * 100);
+    canvas.Printf(row, tree_ram_column, time_column - tree_ram_column, attr,
+                  "%ld", line.rssMb);
+    Format::ElapsedTime(process.upTime, field, sizeof(field));
+    canvas.Put(row, time_column, command_column - time_column, field, attr);
+    const char* mark{!line.children ? "  " : line.collapsed ? "+ " : "- "};
+    if (line.collapsed) {
+      std::snprintf(command, sizeof(command), "%*s%s%s (%d)",
+                    line.depth * 2, "", mark, process.command,
+                    line.processes - 1);
+    } else {
+      std::snprintf(command, sizeof(command), "%*s%s%s", line.depth * 2, "",
+                    mark, process.command);
+    }
+    canvas.Put(row, command_column, canvas.Width(), command, attr);
+  }
+}
+
+// The top threads, each with the command of its process when that is one
+// of the rows. The header names the process when only its threads are
+// shown.
+void NCursesDisplay::DisplayThreads(const Frame& frame, Canvas& canvas,
+                                    int n) {
+  int const tid_column{2};
+  int const pid_column{10};
+  int const cpu_column{18};
+  int const state_column{26};
+  int const processor_column{29};
+  int const name_column{35};
+  int const command_column{52};
+  bool byTid{frame.sortKey == SortKey::kPid};
+  canvas.Put(1, tid_column, pid_column - tid_column, "TID",
+             COLOR_PAIR(2) | (byTid ? A_REVERSE : A_NORMAL));
+  canvas.Put(1, pid_column, cpu_column - pid_column, "PID", COLOR_PAIR(2));
+  canvas.Put(1, cpu_column, state_column - cpu_column, "CPU[%]",
+             COLOR_PAIR(2) | (byTid ? A_NORMAL : A_REVERSE));
+  canvas.Put(1, state_column, processor_column - state_column, "S",
+             COLOR_PAIR(2));
+  canvas.Put(1, processor_column, name_column - processor_column, "CORE",
+             COLOR_PAIR(2));
+  canvas.Put(1, name_column, command_column - name_column, "THREAD",
+             COLOR_PAIR(2));
+  if (frame.threadPid > 0) {
+    canvas.Printf(1, command_column, canvas.Width(), COLOR_PAIR(2),
+                  "COMMAND (threads of %d)", frame.threadPid);
+  } else {
+    canvas.Put(1, command_column, canvas.Width(), "COMMAND", COLOR_PAIR(2));
+  }
+  int rows = std::min<int>(n, frame.threads.size());
+  for (int i = 0; i < n; ++i) {
+    int row{2 + i};
+    if (i >= rows) {
+      canvas.Put(row, 1, canvas.Width(), "");
+      continue;
+    }
+    const ThreadRow& thread = frame.threads[i];
+    canvas.Printf(row, tid_column, pid_column - tid_column, A_NORMAL, "%d",
+                  thread.tid);
+    canvas.Printf(row, pid_column, cpu_column - pid_column, A_NORMAL, "%d",
+                  thread.pid);
+    canvas.Printf(row, cpu_column, state_column - cpu_column, A_NORMAL,
+                  "%.1f", thread.cpu * 100);
+    canvas.Printf(row, state_column, processor_column - state_column,
+                  A_NORMAL, "%c", thread.state);
+    canvas.Printf(row, processor_column, name_column - processor_column,
+                  A_NORMAL, "%d", thread.processor);
+    canvas.Put(row, name_column, command_column - name_column, thread.name);
+    const char* command{""};
+    for (const ProcessRow& process : frame.rows) {
+      if (process.pid == thread.pid) {
+        command = process.command;
+        break;
+      }
+    }
+    canvas.Put(row, command_column, canvas.Width(), command);
+  }
+}
+
+// Each field is padded to the start of the next column, and rows past the
+// end of the frame are blanked, so nothing of a previous frame remains.
+// Grouped, tree and thread views have layouts of their own.
+void NCursesDisplay::DisplayProcesses(const Frame& frame, Canvas& canvas,
+                                      int n, int selected) {
+  if (frame.threadView) {
+    DisplayThreads(frame, canvas, n);
+    return;
+  }
+  if (frame.groupBy == GroupBy::kCgroup) {
+    DisplayCgroups(frame, canvas, n);
+    return;
+  }
+  if (frame.groupBy != GroupBy::kNone) {
+    DisplayGroups(frame, canvas, n);
+    return;
+  }
+  if (frame.treeView) {
+    DisplayTree(frame, canvas, n, selected);
+    return;
+  }
   int row{0};
   int const pid_column{2};
   int const user_column{9};
   int const cpu_column{16};
   int const ram_column{26};
-  int const time_column{35};
-  int const command_column{46};
-  wattron(window, COLOR_PAIR(2));
-  mvwprintw(window, ++row, pid_column, "PID");
-  mvwprintw(window, row, user_column, "USER");
-  mvwprintw(window, row, cpu_column, "CPU[%%]");
-  mvwprintw(window, row, ram_column, "RAM[MB]");
-  mvwprintw(window, row, time_column, "TIME+");
-  mvwprintw(window, row, command_column, "COMMAND");
-  wattroff(window, COLOR_PAIR(2));
+  int const field_width{9};   // of RSS and the optional columns after it
+  int const time_width{11};
+  int const command_min{20};  // cells COMMAND keeps on a narrow window
+  // Optional columns are laid out only when the rows carry them, and
+  // dropped from the right while COMMAND would get fewer than command_min
+  // cells: calls first, then the rates, swap and PSS
+  bool pss{frame.columns.smaps};
+  bool swap{frame.columns.swap};
+  bool rates{frame.columns.io};
+  bool calls{frame.columns.io};
+  auto command_at = [&]() {
+    return ram_column + field_width * (1 + pss + swap + 2 * rates + calls) +
+           time_width;
+  };
+  while (command_at() + command_min > canvas.Width() - 1) {
+    bool& dropped = calls ? calls : rates ? rates : swap ? swap : pss;
+    if (!dropped) {
+      break;
+    }
+    dropped = false;
+  }
+  int const pss_column{ram_column + field_width};
+  int const swap_column{pss_column + (pss ? field_width : 0)};
+  int const read_column{swap_column + (swap ? field_width : 0)};
+  int const write_column{read_column + field_width};
+  int const calls_column{read_column + (rates ? 2 * field_width : 0)};
+  int const time_column{calls_column + (calls ? field_width : 0)};
+  int const command_column{time_column + time_width};
+  // The column the list is sorted by is shown in reverse video
+  SortKey key{frame.sortKey};
+  auto header = [&canvas, key](int column, SortKey sorts, const char* title) {
+    attr_t attr = COLOR_PAIR(2) | (sorts == key ? A_REVERSE : A_NORMAL);
+    canvas.Put(1, column, 8, title, attr);
+  };
+  ++row;
+  header(pid_column, SortKey::kPid, "PID");
+  canvas.Put(row, user_column, 7, "USER", COLOR_PAIR(2));
+  header(cpu_column, SortKey::kCpu, "CPU[%]");
+  header(ram_column, SortKey::kMemory, "RSS[MB]");
+  if (pss) {
+    canvas.Put(row, pss_column, field_width, "PSS[MB]", COLOR_PAIR(2));
+  }
+  if (swap) {
+    canvas.Put(row, swap_column, field_width, "SWAP[MB]", COLOR_PAIR(2));
+  }
+  if (rates) {
+    header(read_column, SortKey::kIo, "RD[KB/s]");
+    header(write_column, SortKey::kIo, "WR[KB/s]");
+  }
+  if (calls) {
+    canvas.Put(row, calls_column, field_width, "CALLS/s", COLOR_PAIR(2));
+  }
+  header(time_column, SortKey::kUpTime, "TIME+");
+  canvas.Put(row, command_column, canvas.Width(), "COMMAND", COLOR_PAIR(2));
+  int rows = std::min<int>(n, frame.rows.size());
+  char field[32];
   for (int i = 0; i < n; ++i) {
-    mvwprintw(window, ++row, pid_column, to_string(processes[i].Pid()).c_str());
-    mvwprintw(window, row, user_column, processes[i].User().c_str());
-    float cpu = processes[i].CpuUtilization() * 100;
-    mvwprintw(window, row, cpu_column, to_string(cpu).substr(0, 4).c_str());
-    mvwprintw(window, row, ram_column, processes[i].Ram().c_str());
-    mvwprintw(window, row, time_column,
-              Format::ElapsedTime(processes[i].UpTime()).c_str());
-    mvwprintw(window, row, command_column,
-              processes[i].Command().substr(0, window->_maxx - 46).c_str());
+    ++row;
+    if (i >= rows) {
+      canvas.Put(row, 1, canvas.Width(), "");
+      continue;
+    }
+    const ProcessRow& process = frame.rows[i];
+    canvas.Printf(row, pid_column, user_column - pid_column, A_NORMAL, "%d",
+                  process.pid);
+    canvas.Printf(row, user_column, cpu_column - user_column, A_NORMAL,
+                  "%.6s", process.user);
+    // Cut, not rounded, to four characters
+    std::snprintf(field, sizeof(field), "%f",
+                  static_cast<double>(process.cpu * 100));
+    field[4] = '\0';
+    canvas.Put(row, cpu_column, ram_column - cpu_column, field);
+    canvas.Printf(row, ram_column, field_width, A_NORMAL, "%ld",
+                  process.rssMb);
+    // Unknown until smaps_rollup or io was read, or when it may not be
+    auto known = [&canvas, row](int column, long value) {
+      if (value < 0) {
+        canvas.Put(row, column, field_width, "-");
+      } else {
+        canvas.Printf(row, column, field_width, A_NORMAL, "%ld", value);
+      }
+    };
+    if (pss) {
+      known(pss_column, process.pssMb);
+    }
+    if (swap) {
+      known(swap_column, process.swapMb);
+    }
+    if (rates) {
+      known(read_column, process.readKbPerSecond);
+      known(write_column, process.writeKbPerSecond);
+    }
+    if (calls) {
+      known(calls_column, process.readCallsPerSecond < 0
+                              ? -1
+                              : std::lround(process.readCallsPerSecond +
+                                            process.writeCallsPerSecond));
+    }
+    Format::ElapsedTime(process.upTime, field, sizeof(field));
+    canvas.Put(row, time_column, time_width, field);
+    canvas.Put(row, command_column, canvas.Width(), process.command);
   }
 }
 
-void NCursesDisplay::Display(System& system, int n) {
-  initscr();      // start ncurses
-  noecho();       // do not print input values
-  cbreak();       // terminate ncurses on ctrl + c
-  start_color();  // enable color
+// Sort keys: c = CPU, m = memory, t = time, p = pid, i = I/O. Returns
+// false on q.
+bool NCursesDisplay::HandleKey(Collector& collector, int key) {
+  switch (key) {
+    case 'c': collector.SetSortKey(SortKey::kCpu); break;
+    case 'm': collector.SetSortKey(SortKey::kMemory); break;
+    case 't': collector.SetSortKey(SortKey::kUpTime); break;
+    case 'p': collector.SetSortKey(SortKey::kPid); break;
+    case 'i': collector.SetSortKey(SortKey::kIo); break;
+    case 'q': return false;
+    default: break;
+  }
+  return true;
+}
 
-  int x_max{getmaxx(stdscr)};
-  WINDOW* system_window = newwin(9, x_max - 1, 0, 0);
-  WINDOW* process_window =
-      newwin(3 + n, x_max - 1, system_window->_maxy + 1, 0);
-
-  while (1) {
-    init_pair(1, COLOR_YELLOW, COLOR_BLACK);
-    init_pair(2, COLOR_CYAN, COLOR_BLACK);
-    box(system_window, 0, 0);
-    box(process_window, 0, 0);
-    DisplaySystem(system, system_window);
-    DisplayProcesses(system.Processes(), process_window, n);
-    wrefresh(system_window);
-    wrefresh(process_window);
-    refresh();
-    std::this_thread::sleep_for(std::chrono::seconds(1));
+// Last, median and 99th percentile of each phase's time, allocations and
+// system calls over the profiler's window
+void NCursesDisplay::DisplayProfile(const Profiler::Report& profile,
+                                    Canvas& canvas) {
+  canvas.Box();
+  canvas.Printf(0, 2, 20, A_NORMAL, " profile, %zu ticks ", profile.ticks);
+  attr_t title{COLOR_PAIR(2)};
+  canvas.Printf(1, 12, 57, title, "%s%s%s", " ---- time [us] ---",
+                " -- allocations ---", " ---- syscalls ----");
+  canvas.Printf(2, 2, 67, title, "%-10s%s%s%s", "phase",
+                "  last   p50   p99 ", "  last   p50   p99 ",
+                "  last   p50   p99 ");
+  for (int phase{0}; phase < Profiler::kPhases; ++phase) {
+    Profiler::Phase p{static_cast<Profiler::Phase>(phase)};
+    canvas.Printf(3 + phase, 2, 10, A_NORMAL, "%s", Profiler::Name(p));
+    for (int counter{0}; counter < Profiler::kCounters; ++counter) {
+      Profiler::Counter c{static_cast<Profiler::Counter>(counter)};
+      const Profiler::Summary& summary{profile.values[phase][counter]};
+      long long scale{c == Profiler::Counter::kTime ? 1000 : 1};
+      canvas.Printf(3 + phase, 12 + counter * 19, 19, A_NORMAL,
+                    "%6lld%6lld%6lld", summary.last / scale,
+                    summary.p50 / scale, summary.p99 / scale);
+    }
   }
+  canvas.Flush();
+}
+
+// The busiest disks and network interfaces with their rates, as many as
+// the panel has rows for
+void NCursesDisplay::DisplayDevices(const Frame& frame, Canvas& canvas) {
+  int const name_column{2};
+  int const columns[] = {14, 23, 32, 43, 54, 62};
+  int const end_column{device_columns - 1};
+  auto width = [&columns, end_column](int i) {
+    return (i + 1 < 6 ? columns[i + 1] : end_column) - columns[i];
+  };
+  canvas.Box();
+  canvas.Put(0, 2, 9, " devices ");
+  attr_t title{COLOR_PAIR(2)};
+  auto header = [&](int row, const char* name, const char* const* titles) {
+    canvas.Put(row, name_column, columns[0] - name_column, name, title);
+    for (int i{0}; i < 6; ++i) {
+      canvas.Put(row, columns[i], width(i), titles[i], title);
+    }
+  };
+  const char* const disk_titles[] = {"READ/s",   "WRITE/s", "RD[KB/s]",
+                                     "WR[KB/s]", "UTIL[%]", "QUEUE"};
+  const char* const net_titles[] = {"RX[KB/s]", "TX[KB/s]", "RX PKT/s",
+                                    "TX PKT/s", "RX DROP", "TX DROP"};
+  int row{1};
+  header(row, "DISK", disk_titles);
+  for (int i{0}; i < device_panel_rows; ++i) {
+    ++row;
+    if (i >= static_cast<int>(frame.disks.size())) {
+      canvas.Put(row, 1, canvas.Width(), "");
+      continue;
+    }
+    const DiskRow& disk = frame.disks[i];
+    canvas.Put(row, name_column, columns[0] - name_column - 1, disk.name);
+    canvas.Printf(row, columns[0], width(0), A_NORMAL, "%.1f",
+                  disk.readsPerSecond);
+    canvas.Printf(row, columns[1], width(1), A_NORMAL, "%.1f",
+                  disk.writesPerSecond);
+    canvas.Printf(row, columns[2], width(2), A_NORMAL, "%ld",
+                  disk.readKbPerSecond);
+    canvas.Printf(row, columns[3], width(3), A_NORMAL, "%ld",
+                  disk.writeKbPerSecond);
+    canvas.Printf(row, columns[4], width(4), A_NORMAL, "%.1f",
+                  disk.utilization * 100);
+    canvas.Printf(row, columns[5], width(5), A_NORMAL, "%.2f",
+                  disk.queueDepth);
+  }
+  header(++row, "NET", net_titles);
+  for (int i{0}; i < device_panel_rows; ++i) {
+    ++row;
+    if (i >= static_cast<int>(frame.networks.size())) {
+      canvas.Put(row, 1, canvas.Width(), "");
+      continue;
+    }
+    const NetRow& network = frame.networks[i];
+    canvas.Put(row, name_column, columns[0] - name_column - 1, network.name);
+    canvas.Printf(row, columns[0], width(0), A_NORMAL, "%ld",
+                  network.rxKbPerSecond);
+    canvas.Printf(row, columns[1], width(1), A_NORMAL, "%ld",
+                  network.txKbPerSecond);
+    canvas.Printf(row, columns[2], width(2), A_NORMAL, "%.1f",
+                  network.rxPacketsPerSecond);
+    canvas.Printf(row, columns[3], width(3), A_NORMAL, "%.1f",
+                  network.txPacketsPerSecond);
+    canvas.Printf(row, columns[4], width(4), A_NORMAL, "%.1f",
+                  network.rxDropsPerSecond);
+    canvas.Printf(row, columns[5], width(5), A_NORMAL, "%.1f",
+                  network.txDropsPerSecond);
+  }
+  canvas.Flush();
+}
+
+// Live view. A Collector refreshes the system on its own thread; this
+// one draws each snapshot it publishes and handles keys as they come,
+// sleeping in poll() on both in between. o shows the profile of the
+// monitor itself over the process list, d the rates of the disks and
+// network interfaces over its left side, g groups the list by user, then
+// by command name, then shows cgroups, and T switches to the process tree
+// and back. H shows the threads of the rows, or in tree view of the
+// selected process, and goes back.
+void NCursesDisplay::Display(System& system, int n, HistoryRing* recorder) {
+  Start();
+
+  // The first snapshot tells how many cores need a bar
+  system.Refresh();
+  WINDOW* system_window;
+  WINDOW* process_window;
+  CreateWindows(system.Cpu().CoreCount(), n, system_window, process_window);
+  int columns{std::min(profile_columns, getmaxx(stdscr) - 1)};
+  Canvas system_canvas(system_window);
+  Canvas process_canvas(process_window);
+  Canvas profile_canvas(newwin(profile_rows, columns,
+                               getbegy(process_window),
+                               std::max(0, getmaxx(stdscr) - 1 - columns)));
+  Canvas device_canvas(
+      newwin(device_rows, std::min(device_columns, getmaxx(stdscr) - 1),
+             getbegy(process_window), 0));
+
+  Collector collector(system, n, recorder);
+  if (!collector.Start()) {
+    endwin();
+    return;
+  }
+  timeout(0);  // poll() does the waiting
+  pollfd events[2] = {{STDIN_FILENO, POLLIN, 0},
+                      {collector.Notifier(), POLLIN, 0}};
+  unsigned long long drawn{0};
+  // Drawing happens on this thread, so it is measured here rather than
+  // by the collector
+  Profiler renderer;
+  Profiler::Report report;
+  GroupBy group{system.GetGroupBy()};
+  bool tree{system.GetTreeView()};
+  bool threads{system.GetThreadView()};
+  int selected{0};  // row of the tree view
+  long offset{0};   // tree lines above the first row
+  bool profile{false};
+  bool devices{false};
+  bool running{true};
+  while (running) {
+    const Snapshot& snapshot = system.Latest();
+    const Frame& frame = snapshot.frame;
+    if (snapshot.sequence != drawn) {
+      selected = std::max(0, std::min<int>(selected,
+                                           frame.tree.size() - 1));
+      {
+        Profiler::Scope output(renderer, Profiler::Phase::kOutput);
+        Draw(frame, system_canvas, process_canvas, n, tree ? selected : -1);
+        if (devices) {
+          device_canvas.Touch();
+          DisplayDevices(frame, device_canvas);
+        }
+        if (profile) {
+          // The collector's phases, and the output measured here
+          report = snapshot.profile;
+          for (int counter{0}; counter < Profiler::kCounters; ++counter) {
+            Profiler::Counter c{static_cast<Profiler::Counter>(counter)};
+            report.values[static_cast<int>(Profiler::Phase::kOutput)]
+                         [counter] = renderer.Get(Profiler::Phase::kOutput, c);
+          }
+          // Repainted whole, or changes of the process window underneath
+          // would show through its unchanged cells
+          profile_canvas.Touch();
+          DisplayProfile(report, profile_canvas);
+        }
+        doupdate();
+      }
+      renderer.EndTick();
+      drawn = snapshot.sequence;
+    }
+
+    poll(events, 2, -1);
+    if (events[1].revents & POLLIN) {
+      collector.Acknowledge();
+    }
+    for (int pressed{getch()}; pressed != ERR && running;
+         pressed = getch()) {
+      if (pressed == 'o') {
+        profile = !profile;
+        if (!profile) {
+          // Bring back what the profile covered
+          system_canvas.Touch();
+          process_canvas.Touch();
+        }
+        drawn = 0;  // draw again with or without the profile
+      }
+      if (pressed == 'd') {
+        devices = !devices;
+        if (!devices) {
+          system_canvas.Touch();
+          process_canvas.Touch();
+        }
+        drawn = 0;
+      }
+      if (pressed == 'g') {
+        // Processes, then by user, by command name and by cgroup
+        group = group == GroupBy::kNone      ? GroupBy::kUser
+                : group == GroupBy::kUser    ? GroupBy::kCommand
+                : group == GroupBy::kCommand ? GroupBy::kCgroup
+                                             : GroupBy::kNone;
+        collector.SetGroupBy(group);
+        tree = false;
+        collector.SetTreeView(tree);
+        threads = false;
+        collector.SetThreadView(threads, 0);
+      }
+      if (pressed == 'T') {
+        tree = !tree;
+        collector.SetTreeView(tree);
+        group = GroupBy::kNone;
+        collector.SetGroupBy(group);
+        threads = false;
+        collector.SetThreadView(threads, 0);
+        drawn = 0;  // show or hide the selection right away
+      }
+      if (pressed == 'H') {
+        threads = !threads;
+        bool picked{threads && tree && frame.treeView &&
+                    selected < static_cast<int>(frame.rows.size())};
+        collector.SetThreadView(threads,
+                                picked ? frame.rows[selected].pid : 0);
+        group = GroupBy::kNone;
+        collector.SetGroupBy(group);
+      }
+      if (tree && !threads && frame.treeView &&
+          TreeKey(frame, collector, pressed, n, selected, offset)) {
+        drawn = 0;
+        continue;
+      }
+      running = HandleKey(collector, pressed);
+    }
+  }
+  collector.Stop();
   endwin();
-}
\ No newline at end of file
+}
+
+// Plays a recorded history back at the pace it was recorded.
+// space = pause, left/right = one frame back/forward, page up/down = 60
+// frames, home/end = first/last frame, f/s = faster/slower, q = quit.
+void NCursesDisplay::Replay(HistoryRing& history, int n) {
+  if (history.Size() == 0) {
+    return;
+  }
+  Start();
+
+  Frame frame;
+  history.Read(0, frame);
+  WINDOW* system_window;
+  WINDOW* process_window;
+  CreateWindows(frame.cores.size(), n, system_window, process_window);
+  Canvas system_canvas(system_window);
+  Canvas process_canvas(process_window);
+
+  long last = static_cast<long>(history.Size()) - 1;
+  long index{0};
+  int speed{1};
+  bool paused{false};
+  bool running{true};
+  while (running) {
+    history.Read(index, frame);
+    std::time_t seconds = static_cast<std::time_t>(frame.timestampMs / 1000);
+    char when[32];
+    std::strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S",
+                  std::localtime(&seconds));
+    process_canvas.Printf(process_canvas.Height() - 1, 2, 56, A_NORMAL,
+                          " REPLAY %s  %ld/%ld  x%d %s", when, index + 1,
+                          last + 1, speed, paused ? "paused " : "");
+    Draw(frame, system_canvas, process_canvas, n);
+    doupdate();
+
+    // Wait as long as the recording did until the next frame, capped so
+    // gaps in the recording do not stall playback
+    if (paused || index == last) {
+      timeout(-1);
+    } else {
+      long gap = static_cast<long>(history.Timestamp(index + 1) -
+                                   frame.timestampMs) / speed;
+      timeout(static_cast<int>(std::max(0L, std::min(gap, 5000L))));
+    }
+
+    long previous{index};
+    switch (getch()) {
+      case ERR: ++index; break;
+      case ' ': paused = !paused; break;
+      case KEY_RIGHT: ++index; break;
+      case KEY_LEFT: --index; break;
+      case KEY_NPAGE: index += 60; break;
+      case KEY_PPAGE: index -= 60; break;
+      case KEY_HOME: index = 0; break;
+      case KEY_END: index = last; break;
+      case 'f': speed = std::min(speed * 2, 64); break;
+      case 's': speed = std::max(speed / 2, 1); break;
+      case 'q': running = false; break;
+      default: break;
+    }
+    index = std::max(0L, std::min(index, last));
+    if (index == last && previous != last) {
+      paused = true;  // stop at the end of the recording
+    }
+  }
+  endwin();
+}
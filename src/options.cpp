@@ -0,0 +1,181 @@
+#include "../include/options.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "../include/history_ring.h"
+#include "../include/proc_scanner.h"
+
+using std::string;
+
+namespace {
+// Far above any useful setting, low enough that row and thread counts
+// stay small ints
+const long kMaxTop{10000};
+const long kMaxThreads{256};
+
+// Reads the integer value following argv[i], advancing i past it
+bool IntValue(int argc, char* argv[], int& i, long& value) {
+  if (i + 1 >= argc) {
+    return false;
+  }
+  try {
+    std::size_t used{0};
+    value = std::stol(argv[i + 1], &used);
+    if (argv[i + 1][used] != '\0') {
+      return false;
+    }
+  } catch (const std::exception&) {
+    return false;
+  }
+  ++i;
+  return true;
+}
+
+// A comma separated list of user, command, swap, smaps and io turns on
+// the columns listed and off the others
+bool ColumnsValue(const char* list, Columns& columns) {
+  columns = Columns{false, false, false, false, false};
+  string text{list};
+  std::size_t start{0};
+  while (start <= text.size()) {
+    std::size_t comma = std::min(text.find(',', start), text.size());
+    string name{text.substr(start, comma - start)};
+    if (name == "user") {
+      columns.user = true;
+    } else if (name == "command") {
+      columns.command = true;
+    } else if (name == "swap") {
+      columns.swap = true;
+    } else if (name == "smaps") {
+      columns.smaps = true;
+    } else if (name == "io") {
+      columns.io = true;
+    } else {
+      return false;
+    }
+    start = comma + 1;
+  }
+  return true;
+}
+}  // namespace
+
+// Returns false, after reporting the offending argument, on bad input
+bool CommandLine::Parse(int argc, char* argv[], Options& options) {
+  options.threads = ProcScanner::DefaultThreads();
+  for (int i{1}; i < argc; ++i) {
+    string arg{argv[i]};
+    long value{0};
+    bool ok{true};
+    if (arg == "-t" || arg == "--threads") {
+      ok = IntValue(argc, argv, i, value) && value > 0 &&
+           value <= kMaxThreads;
+      options.threads = static_cast<int>(value);
+    } else if (arg == "-n" || arg == "--top") {
+      ok = IntValue(argc, argv, i, value) && value > 0 && value <= kMaxTop;
+      options.top = static_cast<int>(value);
+    } else if (arg == "-r" || arg == "--root") {
+      ok = i + 1 < argc;
+      options.root = ok ? argv[++i] : "";
+    } else if (arg == "-C" || arg == "--columns") {
+      ok = i + 1 < argc && ColumnsValue(argv[++i], options.columns);
+    } else if (arg == "-g" || arg == "--group") {
+      ok = i + 1 < argc;
+      string group{ok ? argv[++i] : ""};
+      if (group == "user") {
+        options.groupBy = GroupBy::kUser;
+      } else if (group == "command") {
+        options.groupBy = GroupBy::kCommand;
+      } else if (group == "cgroup") {
+        options.groupBy = GroupBy::kCgroup;
+      } else {
+        ok = false;
+      }
+    } else if (arg == "-T" || arg == "--tree") {
+      options.tree = true;
+    } else if (arg == "-H" || arg == "--tasks") {
+      options.threadView = true;
+    } else if (arg == "--tasks-of") {
+      ok = IntValue(argc, argv, i, value) && value > 0 && value <= INT_MAX;
+      options.threadView = true;
+      options.threadPid = static_cast<int>(value);
+    } else if (arg == "--netlink") {
+      options.netlink = true;
+    } else if (arg == "--headless") {
+      options.headless = true;
+    } else if (arg == "-i" || arg == "--interval") {
+      ok = IntValue(argc, argv, i, value) && value > 0 && value <= INT_MAX;
+      options.intervalMs = static_cast<int>(value);
+    } else if (arg == "-c" || arg == "--count") {
+      ok = IntValue(argc, argv, i, value) && value >= 0;
+      options.count = value;
+    } else if (arg == "-f" || arg == "--format") {
+      ok = i + 1 < argc;
+      string format{ok ? argv[++i] : ""};
+      if (format == "json") {
+        options.format = FrameWriter::Format::kJsonLines;
+      } else if (format == "binary") {
+        options.format = FrameWriter::Format::kBinary;
+      } else {
+        ok = false;
+      }
+    } else if (arg == "-o" || arg == "--output") {
+      ok = i + 1 < argc;
+      options.output = ok ? argv[++i] : "";
+    } else if (arg == "--profile") {
+      ok = i + 1 < argc;
+      options.profile = ok ? argv[++i] : "";
+    } else if (arg == "--record") {
+      ok = i + 1 < argc;
+      options.record = ok ? argv[++i] : "";
+    } else if (arg == "--record-slots") {
+      ok = IntValue(argc, argv, i, value) && value > 0 &&
+           value <= static_cast<long>(HistoryRing::kMaxCapacity);
+      options.recordSlots = value;
+    } else if (arg == "--replay") {
+      ok = i + 1 < argc;
+      options.replay = ok ? argv[++i] : "";
+    } else if (arg == "-h" || arg == "--help") {
+      return false;
+    } else {
+      ok = false;
+    }
+
+    if (!ok) {
+      std::fprintf(stderr, "invalid argument: %s\n", arg.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+void CommandLine::Usage(const char* program) {
+  std::fprintf(
+      stderr,
+      "usage: %s [options]\n"
+      "  -t, --threads N     threads scanning /proc, up to 256\n"
+      "  -n, --top N         processes shown or recorded per tick, up to\n"
+      "                      10000 (10)\n"
+      "  -r, --root DIR      read DIR/proc and DIR/etc, not the live system\n"
+      "  -C, --columns LIST  row fields read besides pid, CPU, RSS and time,\n"
+      "                      of user,command,swap,smaps,io (all)\n"
+      "  -g, --group BY      sum processes up by user or command, or show\n"
+      "                      cgroups\n"
+      "  -T, --tree          show the process tree with subtree sums\n"
+      "  -H, --tasks         show the threads of the processes shown\n"
+      "      --tasks-of PID  show the threads of process PID\n"
+      "      --netlink       discover processes through the proc connector\n"
+      "      --headless      collect without the ncurses display\n"
+      "  -i, --interval MS   headless collection interval (1000)\n"
+      "  -c, --count N       headless ticks to collect, 0 = forever (0)\n"
+      "  -f, --format F      headless output, json or binary (json)\n"
+      "  -o, --output FILE   headless destination, - for stdout (-)\n"
+      "      --profile FILE  headless per phase costs of the monitor itself\n"
+      "      --record FILE   keep a history ring of every frame in FILE\n"
+      "      --record-slots N  frames the ring holds, up to 1000000 (21600)\n"
+      "      --replay FILE   play a recorded history back\n",
+      program);
+}
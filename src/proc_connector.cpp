@@ -0,0 +1,170 @@
+#include "../include/proc_connector.h"
+
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "../include/linux_parser.h"
+
+using std::vector;
+
+namespace {
+const std::chrono::seconds kReconcileInterval{30};
+
+// How long the listener blocks before it checks whether to stop
+const int kPollTimeoutMs{200};
+
+// Large enough to ride out fork storms between two wakeups
+const int kReceiveBuffer{4 * 1024 * 1024};
+}  // namespace
+
+ProcConnector::~ProcConnector() {
+  stop_ = true;
+  if (listener_.joinable()) {
+    listener_.join();
+  }
+  if (socket_ >= 0) {
+    close(socket_);
+  }
+}
+
+// Subscribes to process events and takes the initial pid set from /proc
+bool ProcConnector::Start() {
+  socket_ = socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+  if (socket_ < 0) {
+    return false;
+  }
+  setsockopt(socket_, SOL_SOCKET, SO_RCVBUF, &kReceiveBuffer,
+             sizeof(kReceiveBuffer));
+
+  sockaddr_nl address{};
+  address.nl_family = AF_NETLINK;
+  address.nl_groups = CN_IDX_PROC;
+  address.nl_pid = 0;  // let the kernel assign a port
+  // A netlink header carrying a connector message whose payload is the
+  // multicast operation
+  const std::size_t payload{sizeof(cn_msg) + sizeof(proc_cn_mcast_op)};
+  alignas(nlmsghdr) char request[NLMSG_SPACE(payload)]{};
+  auto* header = reinterpret_cast<nlmsghdr*>(request);
+  header->nlmsg_len = NLMSG_LENGTH(payload);
+  header->nlmsg_type = NLMSG_DONE;
+  auto* message = static_cast<cn_msg*>(NLMSG_DATA(header));
+  message->id.idx = CN_IDX_PROC;
+  message->id.val = CN_VAL_PROC;
+  message->len = sizeof(proc_cn_mcast_op);
+  proc_cn_mcast_op op{PROC_CN_MCAST_LISTEN};
+  std::memcpy(message->data, &op, sizeof(op));
+
+  if (bind(socket_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) <
+          0 ||
+      send(socket_, request, header->nlmsg_len, 0) < 0) {
+    close(socket_);
+    socket_ = -1;
+    return false;
+  }
+
+  Reconcile();
+  listener_ = std::thread(&ProcConnector::Listen, this);
+  return true;
+}
+
+// Copies the live set, rebuilding it from /proc first if it may be stale
+void ProcConnector::Pids(vector<int>& pids) {
+  bool stale{false};
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto age = std::chrono::steady_clock::now() - reconciled_;
+    stale = overflowed_ || age >= kReconcileInterval;
+  }
+  if (stale) {
+    Reconcile();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  pids.assign(live_.begin(), live_.end());
+  born_.clear();
+  shortLivedLast_ = shortLived_;
+  shortLived_ = 0;
+}
+
+int ProcConnector::ShortLived() const { return shortLivedLast_; }
+
+// Events that arrive while /proc is being read are applied to the old set
+// and lost when it is replaced; the next reconciliation picks them up,
+// and samples of pids that are already gone are skipped by the scanner
+void ProcConnector::Reconcile() {
+  LinuxParser::Pids(scan_);
+  std::lock_guard<std::mutex> lock(mutex_);
+  live_.clear();
+  live_.insert(scan_.begin(), scan_.end());
+  overflowed_ = false;
+  reconciled_ = std::chrono::steady_clock::now();
+}
+
+void ProcConnector::Listen() {
+  alignas(nlmsghdr) char buffer[8192];
+  pollfd descriptor{socket_, POLLIN, 0};
+  while (!stop_) {
+    if (poll(&descriptor, 1, kPollTimeoutMs) <= 0) {
+      continue;
+    }
+    ssize_t length = recv(socket_, buffer, sizeof(buffer), 0);
+    if (length < 0) {
+      if (errno == ENOBUFS) {  // the kernel dropped events
+        std::lock_guard<std::mutex> lock(mutex_);
+        overflowed_ = true;
+      }
+      continue;
+    }
+
+    auto* header = reinterpret_cast<nlmsghdr*>(buffer);
+    int remaining = static_cast<int>(length);
+    for (; NLMSG_OK(header, remaining);
+         header = NLMSG_NEXT(header, remaining)) {
+      if (header->nlmsg_type == NLMSG_NOOP ||
+          header->nlmsg_type == NLMSG_ERROR) {
+        continue;
+      }
+      auto* message = static_cast<cn_msg*>(NLMSG_DATA(header));
+      if (message->id.idx == CN_IDX_PROC && message->id.val == CN_VAL_PROC) {
+        Handle(message->data, message->len);
+      }
+    }
+  }
+}
+
+// Only whole processes are tracked; threads (pid != tgid) are ignored
+void ProcConnector::Handle(const void* data, std::size_t length) {
+  proc_event event{};
+  std::memcpy(&event, data, std::min(length, sizeof(event)));
+  std::lock_guard<std::mutex> lock(mutex_);
+  switch (event.what) {
+    case proc_event::PROC_EVENT_FORK:
+      if (event.event_data.fork.child_pid == event.event_data.fork.child_tgid) {
+        live_.insert(event.event_data.fork.child_tgid);
+        born_.insert(event.event_data.fork.child_tgid);
+      }
+      break;
+    case proc_event::PROC_EVENT_EXEC:
+      live_.insert(event.event_data.exec.process_tgid);
+      break;
+    case proc_event::PROC_EVENT_EXIT:
+      if (event.event_data.exit.process_pid ==
+          event.event_data.exit.process_tgid) {
+        live_.erase(event.event_data.exit.process_tgid);
+        if (born_.erase(event.event_data.exit.process_tgid) > 0) {
+          ++shortLived_;
+        }
+      }
+      break;
+    default:
+      break;
+  }
+}
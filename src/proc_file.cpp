@@ -0,0 +1,97 @@
+#include "../include/proc_file.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <utility>
+
+#include "../include/profiler.h"
+
+using std::size_t;
+using std::string;
+
+namespace {
+// Enough for every hot file except /proc/stat on large machines, which
+// grows the buffer once on its first read
+const size_t kInitialSize{4096};
+}  // namespace
+
+ProcFile::ProcFile(const string& filename) { Open(filename); }
+
+ProcFile::~ProcFile() { Close(); }
+
+ProcFile::ProcFile(ProcFile&& other) noexcept
+    : fd_(other.fd_),
+      failureReported_(other.failureReported_),
+      buffer_(std::move(other.buffer_)) {
+  other.fd_ = -1;
+}
+
+ProcFile& ProcFile::operator=(ProcFile&& other) noexcept {
+  if (this != &other) {
+    Close();
+    fd_ = other.fd_;
+    failureReported_ = other.failureReported_;
+    buffer_ = std::move(other.buffer_);
+    other.fd_ = -1;
+  }
+  return *this;
+}
+
+bool ProcFile::Open(const string& filename) {
+  Close();
+  Profiler::CountSyscalls();
+  fd_ = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd_ >= 0) {
+    failureReported_ = false;
+  }
+  return fd_ >= 0;
+}
+
+void ProcFile::Close() {
+  if (fd_ >= 0) {
+    Profiler::CountSyscalls();
+    close(fd_);
+    fd_ = -1;
+  }
+}
+
+bool ProcFile::IsOpen() const { return fd_ >= 0; }
+
+bool ProcFile::FirstFailure() {
+  if (fd_ >= 0 || failureReported_) {
+    return false;
+  }
+  failureReported_ = true;
+  return true;
+}
+
+// A read that leaves room in the buffer has reached the end of the file,
+// so the usual case is a single pread. Only a full buffer is grown and
+// continued at the offset reached so far.
+size_t ProcFile::Read() {
+  if (fd_ < 0) {
+    return 0;
+  }
+  if (buffer_.empty()) {
+    buffer_.resize(kInitialSize);
+  }
+
+  size_t length{0};
+  while (true) {
+    Profiler::CountSyscalls();
+    ssize_t count = pread(fd_, buffer_.data() + length,
+                          buffer_.size() - length, static_cast<off_t>(length));
+    if (count < 0) {
+      Close();
+      return 0;
+    }
+    length += static_cast<size_t>(count);
+    if (count == 0 || length < buffer_.size()) {
+      return length;
+    }
+    buffer_.resize(buffer_.size() * 2);
+  }
+}
+
+const char* ProcFile::Data() const { return buffer_.data(); }
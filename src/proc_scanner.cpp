@@ -0,0 +1,201 @@
+#include "../include/proc_scanner.h"
+
+#include <algorithm>
+#include <string>
+
+using std::size_t;
+using std::string;
+using std::to_string;
+using std::vector;
+
+namespace {
+// Pids claimed per atomic operation, small enough to balance well and
+// large enough to keep the cursors from bouncing between cores
+const size_t kChunk{16};
+
+// Beyond this /proc reads contend in the kernel more than they gain
+const int kMaxDefaultThreads{8};
+}  // namespace
+
+// One thread per core, up to kMaxDefaultThreads
+int ProcScanner::DefaultThreads() {
+  int cores = static_cast<int>(std::thread::hardware_concurrency());
+  return std::max(1, std::min(cores, kMaxDefaultThreads));
+}
+
+// The calling thread works as worker 0, so threads - 1 are started
+ProcScanner::ProcScanner(int threads)
+    : threads_(std::max(1, threads)), ranges_(threads_) {
+  for (int worker{1}; worker < threads_; ++worker) {
+    workers_.emplace_back(&ProcScanner::WorkerLoop, this, worker);
+  }
+}
+
+ProcScanner::~ProcScanner() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  start_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+int ProcScanner::Threads() const { return threads_; }
+
+std::chrono::nanoseconds ProcScanner::LastScanTime() const {
+  return lastScanTime_;
+}
+
+// Fills samples[i] with the files of pids[i]
+void ProcScanner::Scan(const vector<int>& pids, vector<ProcSample>& samples,
+                       bool withStatus, bool withIo) {
+  auto begin = std::chrono::steady_clock::now();
+  samples.resize(pids.size());
+  withStatus_ = withStatus;
+  withIo_ = withIo;
+
+  if (threads_ == 1) {
+    for (size_t i{0}; i < pids.size(); ++i) {
+      Read(pids[i], samples[i]);
+    }
+  } else {
+    size_t share = (pids.size() + threads_ - 1) / threads_;
+    for (int worker{0}; worker < threads_; ++worker) {
+      size_t first = std::min(pids.size(), worker * share);
+      ranges_[worker].next.store(first, std::memory_order_relaxed);
+      ranges_[worker].end = std::min(pids.size(), first + share);
+    }
+    pids_ = &pids;
+    samples_ = samples.data();
+    charge_ = Profiler::ThreadCounters();
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++job_;
+      pending_ = threads_ - 1;
+    }
+    start_.notify_all();
+    Work(0);
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return pending_ == 0; });
+  }
+
+  lastScanTime_ = std::chrono::steady_clock::now() - begin;
+}
+
+// Drains the worker's own range first, then steals from the others
+void ProcScanner::Work(int worker) {
+  for (int offset{0}; offset < threads_; ++offset) {
+    Range& range = ranges_[(worker + offset) % threads_];
+    while (true) {
+      size_t first = range.next.fetch_add(kChunk, std::memory_order_relaxed);
+      if (first >= range.end) {
+        break;
+      }
+      size_t last = std::min(range.end, first + kChunk);
+      for (size_t i{first}; i < last; ++i) {
+        Read((*pids_)[i], samples_[i]);
+      }
+    }
+  }
+}
+
+void ProcScanner::WorkerLoop(int worker) {
+  unsigned long long seen{0};
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_.wait(lock, [this, seen] { return stop_ || job_ != seen; });
+      if (stop_) {
+        return;
+      }
+      seen = job_;
+    }
+    {
+      Profiler::ChargeTo charge(charge_);  // the scan's phase pays for it
+      Work(worker);
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      --pending_;
+    }
+    done_.notify_one();
+  }
+}
+
+// Prefers the descriptors kept open for pid. If they fail the process is
+// gone, and the pid may already belong to a new one, so the files are
+// read again by path.
+void ProcScanner::Read(int pid, ProcSample& sample) {
+  sample.withIo = withIo_;
+  auto files = open_.find(pid);
+  if (files != open_.end()) {
+    ProcFile& stat = files->second.stat;
+    size_t length = stat.Read();
+    sample.ok = length > 0 &&
+                LinuxParser::ParseProcStat(stat.Data(), length, sample.stat);
+    if (sample.ok) {
+      sample.hasStatus = withStatus_ && ReadStatus(pid, sample.status);
+      sample.hasIo = withIo_ && ReadIo(pid, sample.io);
+      return;
+    }
+  }
+  sample.ok = LinuxParser::ParseProcStat(pid, sample.stat);
+  sample.hasStatus = sample.ok && withStatus_ &&
+                     LinuxParser::ParseProcStatus(pid, sample.status);
+  sample.hasIo =
+      sample.ok && withIo_ && LinuxParser::ParseProcIo(pid, sample.io);
+}
+
+bool ProcScanner::ReadStatus(int pid, LinuxParser::ProcStatusRecord& status) {
+  auto files = open_.find(pid);
+  if (files != open_.end()) {
+    ProcFile& file = files->second.status;
+    size_t length = file.Read();
+    if (length > 0) {
+      return LinuxParser::ParseProcStatus(file.Data(), length, status);
+    }
+  }
+  return LinuxParser::ParseProcStatus(pid, status);
+}
+
+// A process kept open without an io descriptor, while its stat is still
+// open, was denied its counters, which is not retried by path on every
+// refresh
+bool ProcScanner::ReadIo(int pid, LinuxParser::ProcIoRecord& io) {
+  auto files = open_.find(pid);
+  if (files != open_.end()) {
+    ProcFile& file = files->second.io;
+    size_t length = file.Read();
+    if (length > 0) {
+      return LinuxParser::ParseProcIo(file.Data(), length, io);
+    }
+    if (files->second.stat.IsOpen()) {
+      return false;
+    }
+  }
+  return LinuxParser::ParseProcIo(pid, io);
+}
+
+// Keeps the stat, status and io files of exactly these pids open. The
+// pids are sorted once, so each open pid is looked up in log time.
+void ProcScanner::KeepOpen(const vector<int>& pids) {
+  kept_.assign(pids.begin(), pids.end());
+  std::sort(kept_.begin(), kept_.end());
+  for (auto files = open_.begin(); files != open_.end();) {
+    bool keep = std::binary_search(kept_.begin(), kept_.end(), files->first);
+    files = keep && files->second.stat.IsOpen() ? std::next(files)
+                                                : open_.erase(files);
+  }
+  for (int pid : pids) {
+    if (open_.count(pid) == 0) {
+      string directory{LinuxParser::ProcDirectory() + to_string(pid)};
+      PidFiles& files = open_[pid];
+      files.stat.Open(directory + LinuxParser::kStatFilename);
+      files.status.Open(directory + LinuxParser::kStatusFilename);
+      files.io.Open(directory + LinuxParser::kIoFilename);
+    }
+  }
+}
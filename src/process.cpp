@@ -4,7 +4,9 @@
 #include <unistd.h>
 
 
+#include <algorithm>
 #include <cctype>
+#include <cstring>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -19,21 +21,171 @@ using std::vector;
 int Process::Pid() { return pid; }
 
 // TODO: Return this process's CPU utilization
-float Process::CpuUtilization() { return LinuxParser::ActiveJiffies(pid); }
+float Process::CpuUtilization() { return cpuUtil; }
 
 // TODO: Return the command that generated this process
-string Process::Command() { return LinuxParser::Command(pid); }
+string Process::Command() {
+  return hasCommand ? string(command) : LinuxParser::Command(pid);
+}
 
 // TODO: Return this process's memory utilization
-string Process::Ram() { return LinuxParser::Ram(pid); }
+string Process::Ram() { return to_string(RamMb()); }
+
+// From the rss field of stat, which every scan reads anyway
+long Process::RamMb() const {
+  static const long pageKb{sysconf(_SC_PAGESIZE) / 1024};
+  return stat.rss * pageKb / 1024;
+}
+
+long Process::PssMb() const { return hasSmaps ? smaps.pss / 1024 : -1; }
+
+long Process::SharedMb() const { return hasSmaps ? smaps.shared / 1024 : -1; }
+
+long Process::PrivateMb() const {
+  return hasSmaps ? smaps.private_ / 1024 : -1;
+}
+
+long Process::SwapMb() const { return swapKb >= 0 ? swapKb / 1024 : -1; }
+
+long Process::ReadKbPerSecond() const {
+  return readBytesPerSecond >= 0 ? static_cast<long>(readBytesPerSecond / 1024)
+                                 : -1;
+}
+
+long Process::WriteKbPerSecond() const {
+  return writeBytesPerSecond >= 0
+             ? static_cast<long>(writeBytesPerSecond / 1024)
+             : -1;
+}
+
+float Process::ReadCallsPerSecond() const { return readCallsPerSecond; }
+
+float Process::WriteCallsPerSecond() const { return writeCallsPerSecond; }
+
+double Process::IoBytesPerSecond() const {
+  return readBytesPerSecond >= 0 ? readBytesPerSecond + writeBytesPerSecond
+                                 : -1;
+}
 
 // TODO: Return the user (name) that generated this process
-string Process::User() { return LinuxParser::User(pid); }
+string Process::User() {
+  if (HasUser()) {
+    return string(user);
+  }
+  return uid >= 0 ? LinuxParser::UserName(uid) : string{};
+}
 
 // TODO: Return the age of this process (in seconds)
-long int Process::UpTime() { return LinuxParser::UpTime(pid); }
+long int Process::UpTime() { return upTime; }
 
 // TODO: Overload the "less than" comparison operator for Process objects
 bool Process::operator<(Process const& a) const {
-  return (a.ramUtil < this->ramUtil );;
-}
\ No newline at end of file
+  return a.stat.rss < stat.rss;
+}
+
+// True if this process is listed before a when ordering by key. The
+// measurements are listed largest first, pids in ascending order.
+bool Process::Precedes(Process const& a, SortKey key) const {
+  switch (key) {
+    case SortKey::kCpu:
+      return a.cpuUtil < cpuUtil;
+    case SortKey::kMemory:
+      return a.stat.rss < stat.rss;
+    case SortKey::kUpTime:
+      return a.upTime < upTime;
+    case SortKey::kPid:
+      return pid < a.pid;
+    case SortKey::kIo:
+      return a.IoBytesPerSecond() < IoBytesPerSecond();
+  }
+  return false;
+}
+
+// Takes a new sample of this process. CPU utilization is measured over the
+// interval since the previous sample; a process seen for the first time has
+// no previous sample and reports its average over its lifetime instead.
+void Process::Update(const LinuxParser::ProcStatRecord& record,
+                     Clock::time_point now, double systemUpTime) {
+  static const long hertz{sysconf(_SC_CLK_TCK)};
+  long ticks = record.utime + record.stime;
+  upTime = static_cast<long>(systemUpTime) -
+           static_cast<long>(record.startTime / hertz);
+
+  if (prevTicks >= 0) {
+    double seconds = std::chrono::duration<double>(now - prevTime).count();
+    if (seconds > 0.0) {
+      cpuUtil = ((ticks - prevTicks) * 1.0 / hertz) / seconds;
+    }
+  } else {
+    double seconds = systemUpTime - (record.startTime * 1.0) / hertz;
+    long totalTime = ticks + record.cutime + record.cstime;
+    cpuUtil = seconds > 0.0 ? ((1.0 * totalTime) / hertz) / seconds : 0.0;
+  }
+
+  // exec() keeps the pid and start time but changes the name
+  if (hasCommand && std::strcmp(stat.comm, record.comm) != 0) {
+    hasCommand = false;
+  }
+  stat = record;
+  prevTicks = ticks;
+  prevTime = now;
+}
+
+// /proc/[pid]/status is only read when its fields are needed, see System
+void Process::UpdateStatus(const LinuxParser::ProcStatusRecord& status) {
+  uid = status.uid;
+  swapKb = status.vmSwap;
+}
+
+void Process::SetCommand(std::string_view text) {
+  command = text;
+  hasCommand = true;
+}
+
+void Process::SetUser(std::string_view name) {
+  user = name;
+  userUid = uid;
+}
+
+// Looked up again when next needed
+void Process::ClearUser() {
+  user = {};
+  userUid = -1;
+}
+
+// record is null if smaps_rollup could not be read, which is kept until
+// expiry too, so an unreadable process is not retried every refresh
+void Process::UpdateSmaps(const LinuxParser::SmapsRollupRecord* record,
+                          Clock::time_point expiry) {
+  hasSmaps = record != nullptr;
+  if (hasSmaps) {
+    smaps = *record;
+  }
+  smapsExpiry = expiry;
+}
+
+// The rates cover the time since the counters were last read, however
+// long ago that was. record is null if io could not be read, which
+// leaves the rates unknown until it was read twice again.
+void Process::UpdateIo(const LinuxParser::ProcIoRecord* record,
+                       Clock::time_point now) {
+  if (record == nullptr) {
+    hasIo = false;
+    readBytesPerSecond = writeBytesPerSecond = -1;
+    readCallsPerSecond = writeCallsPerSecond = -1;
+    return;
+  }
+  double seconds = std::chrono::duration<double>(now - ioTime).count();
+  if (hasIo && seconds > 0.0) {
+    auto rate = [seconds](long long after, long long before) {
+      return std::max(0LL, after - before) / seconds;
+    };
+    readBytesPerSecond = rate(record->readBytes, io.readBytes);
+    writeBytesPerSecond = rate(record->writeBytes, io.writeBytes);
+    readCallsPerSecond = static_cast<float>(rate(record->syscr, io.syscr));
+    writeCallsPerSecond = static_cast<float>(rate(record->syscw, io.syscw));
+  }
+  io = *record;
+  hasIo = true;
+  ioTime = now;
+}
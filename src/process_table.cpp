@@ -0,0 +1,312 @@
+#include "../include/process_table.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <numeric>
+
+#include "../include/linux_parser.h"
+
+using std::size_t;
+using std::vector;
+
+namespace {
+// The first n of top ordered by before(a, b), the rest dropped
+template <typename Before>
+void PartialSort(vector<size_t>& top, size_t n, Before before) {
+  n = std::min(n, top.size());
+  std::partial_sort(top.begin(), top.begin() + n, top.end(), before);
+  top.resize(n);
+}
+}  // namespace
+
+// samples[i] holds what a ProcScanner read for pids[i]
+void ProcessTable::Update(const vector<int>& pids,
+                          const vector<ProcSample>& samples,
+                          double systemUpTime) {
+  ++generation_;
+  Process::Clock::time_point now = Process::Clock::now();
+
+  for (size_t i{0}; i < pids.size(); ++i) {
+    // Skip processes that exited since the pid list was taken
+    if (!samples[i].ok) {
+      continue;
+    }
+    int pid{pids[i]};
+    const LinuxParser::ProcStatRecord& stat = samples[i].stat;
+
+    auto slot = slots_.find(pid);
+    if (slot == slots_.end()) {
+      slot = slots_.emplace(pid, entries_.size()).first;
+      entries_.emplace_back(pid);
+      seen_.push_back(0);
+      nodes_.push_back(tree_.Add(pid, stat.ppid, stat.startTime));
+      columns_.pid.push_back(pid);
+      columns_.ppid.push_back(0);
+      columns_.uid.push_back(-1);
+      columns_.user.push_back(0);
+      columns_.name.push_back(NameId(stat.comm));
+      columns_.cgroup.push_back(0);
+      columns_.ticks.push_back(0);
+      columns_.cpu.push_back(0.0f);
+      columns_.rssKb.push_back(0);
+      columns_.io.push_back(-1.0f);
+      columns_.startTime.push_back(0);
+    } else if (entries_[slot->second].StartTime() != stat.startTime) {
+      entries_[slot->second] = Process(pid);  // the pid was reused
+      tree_.Remove(nodes_[slot->second]);
+      nodes_[slot->second] = tree_.Add(pid, stat.ppid, stat.startTime);
+      columns_.uid[slot->second] = -1;
+      columns_.user[slot->second] = 0;
+      columns_.cgroup[slot->second] = 0;
+    }
+    entries_[slot->second].Update(stat, now, systemUpTime);
+    if (samples[i].hasStatus) {
+      entries_[slot->second].UpdateStatus(samples[i].status);
+    }
+    if (samples[i].withIo) {
+      entries_[slot->second].UpdateIo(
+          samples[i].hasIo ? &samples[i].io : nullptr, now);
+    }
+    Store(slot->second, samples[i]);
+    seen_[slot->second] = generation_;
+  }
+
+  // Retire entries not seen this time by moving the last entry into their slot
+  for (size_t i{0}; i < entries_.size();) {
+    if (seen_[i] == generation_) {
+      ++i;
+      continue;
+    }
+    Retire(i);
+  }
+}
+
+// Entries are never added or removed here, so pointers into Entries()
+// stay valid. A sample of a reused pid is left for Update() to handle.
+void ProcessTable::Resample(const vector<int>& pids,
+                            const vector<ProcSample>& samples,
+                            double systemUpTime) {
+  Process::Clock::time_point now = Process::Clock::now();
+  for (size_t i{0}; i < pids.size(); ++i) {
+    auto slot = slots_.find(pids[i]);
+    if (!samples[i].ok || slot == slots_.end()) {
+      continue;
+    }
+    Process& process = entries_[slot->second];
+    if (process.StartTime() != samples[i].stat.startTime) {
+      continue;
+    }
+    process.Update(samples[i].stat, now, systemUpTime);
+    if (samples[i].hasStatus) {
+      process.UpdateStatus(samples[i].status);
+    }
+    if (samples[i].withIo) {
+      process.UpdateIo(samples[i].hasIo ? &samples[i].io : nullptr, now);
+    }
+    Store(slot->second, samples[i]);
+  }
+}
+
+vector<Process>& ProcessTable::Entries() { return entries_; }
+
+const ProcessColumns& ProcessTable::Columns() const { return columns_; }
+
+// nullptr if pid is not in the table
+Process* ProcessTable::Find(int pid) {
+  auto slot = slots_.find(pid);
+  return slot == slots_.end() ? nullptr : &entries_[slot->second];
+}
+
+ProcessTree& ProcessTable::Tree() { return tree_; }
+
+// Indices of the first n entries in key order: the measurements largest
+// first, pids in ascending order. Only the column of the key is read.
+void ProcessTable::Top(SortKey key, size_t n, vector<size_t>& top) const {
+  top.resize(entries_.size());
+  std::iota(top.begin(), top.end(), size_t{0});
+  const ProcessColumns& c = columns_;
+  switch (key) {
+    case SortKey::kCpu:
+      PartialSort(top, n, [&c](size_t a, size_t b) {
+        return c.cpu[a] > c.cpu[b];
+      });
+      break;
+    case SortKey::kMemory:
+      PartialSort(top, n, [&c](size_t a, size_t b) {
+        return c.rssKb[a] > c.rssKb[b];
+      });
+      break;
+    case SortKey::kUpTime:
+      PartialSort(top, n, [&c](size_t a, size_t b) {
+        return c.startTime[a] < c.startTime[b];
+      });
+      break;
+    case SortKey::kPid:
+      PartialSort(top, n, [&c](size_t a, size_t b) {
+        return c.pid[a] < c.pid[b];
+      });
+      break;
+    case SortKey::kIo:
+      PartialSort(top, n, [&c](size_t a, size_t b) {
+        return c.io[a] > c.io[b];
+      });
+      break;
+  }
+}
+
+// One pass over the id, cpu and rss columns adds every process to its
+// group. The loop has no branches and reads the columns front to back.
+// When most processes fall into one group, consecutive adds into the same
+// sum would wait on each other, so each group has kLanes partial sums
+// that consecutive processes take turns in, merged at the end. Processes
+// whose uid or cgroup was never read form the group of id 0.
+void ProcessTable::Aggregate(GroupBy by, vector<ProcessGroup>& groups) {
+  groups.clear();
+  if (by == GroupBy::kNone) {
+    return;
+  }
+  const vector<std::uint32_t>& ids = by == GroupBy::kUser ? columns_.user
+                                     : by == GroupBy::kCgroup
+                                         ? columns_.cgroup
+                                         : columns_.name;
+  size_t count{by == GroupBy::kUser     ? uids_.size()
+               : by == GroupBy::kCgroup ? cgroups_
+                                        : names_.Size()};
+  groupProcesses_.assign(count * kLanes, 0);
+  groupCpu_.assign(count * kLanes, 0.0f);
+  groupRssKb_.assign(count * kLanes, 0);
+
+  const std::uint32_t* id = ids.data();
+  const float* cpu = columns_.cpu.data();
+  const long long* rss = columns_.rssKb.data();
+  int* processes = groupProcesses_.data();
+  float* cpuSum = groupCpu_.data();
+  long long* rssSum = groupRssKb_.data();
+  for (size_t i{0}, size{entries_.size()}; i < size; ++i) {
+    size_t sum{id[i] * kLanes + i % kLanes};
+    processes[sum] += 1;
+    cpuSum[sum] += cpu[i];
+    rssSum[sum] += rss[i];
+  }
+
+  for (size_t group{0}; group < count; ++group) {
+    ProcessGroup total{static_cast<std::uint32_t>(group), 0, 0.0f, 0};
+    for (size_t lane{0}; lane < kLanes; ++lane) {
+      total.processes += processes[group * kLanes + lane];
+      total.cpu += cpuSum[group * kLanes + lane];
+      total.rssKb += rssSum[group * kLanes + lane];
+    }
+    if (total.processes > 0) {
+      groups.push_back(total);
+    }
+  }
+}
+
+// Maps the process at index of Entries() to a cgroup; it stays there
+// until its pid is reused
+void ProcessTable::SetCgroup(size_t index, std::uint32_t cgroup) {
+  columns_.cgroup[index] = cgroup;
+  cgroups_ = std::max<size_t>(cgroups_, cgroup + 1);
+}
+
+int ProcessTable::UserUid(std::uint32_t user) const { return uids_[user]; }
+
+std::string_view ProcessTable::Name(std::uint32_t name) const {
+  return names_.Get(name);
+}
+
+// Copies what the sample and the freshly updated entry hold into the
+// columns of slot
+void ProcessTable::Store(size_t slot, const ProcSample& sample) {
+  static const long pageKb{sysconf(_SC_PAGESIZE) / 1024};
+  const LinuxParser::ProcStatRecord& stat = sample.stat;
+  columns_.pid[slot] = stat.pid;
+  columns_.ppid[slot] = stat.ppid;
+  columns_.ticks[slot] = stat.utime + stat.stime;
+  columns_.cpu[slot] = entries_[slot].CpuUtilization();
+  columns_.rssKb[slot] = stat.rss * pageKb;
+  columns_.io[slot] = static_cast<float>(entries_[slot].IoBytesPerSecond());
+  columns_.startTime[slot] = stat.startTime;
+  tree_.Update(nodes_[slot], stat.ppid, columns_.cpu[slot],
+               columns_.rssKb[slot]);
+  if (names_.Get(columns_.name[slot]) != stat.comm) {
+    std::uint32_t renamed{NameId(stat.comm)};  // exec() renamed it
+    DropName(columns_.name[slot]);
+    columns_.name[slot] = renamed;
+  }
+  if (sample.hasStatus && sample.status.uid != columns_.uid[slot]) {
+    columns_.uid[slot] = sample.status.uid;
+    columns_.user[slot] = UserId(sample.status.uid);
+  }
+}
+
+// Moves the last entry into slot and drops the last
+void ProcessTable::Retire(size_t slot) {
+  slots_.erase(entries_[slot].Pid());
+  DropName(columns_.name[slot]);
+  tree_.Remove(nodes_[slot]);
+  size_t last{entries_.size() - 1};
+  if (slot != last) {
+    entries_[slot] = entries_[last];
+    seen_[slot] = seen_[last];
+    nodes_[slot] = nodes_[last];
+    columns_.pid[slot] = columns_.pid[last];
+    columns_.ppid[slot] = columns_.ppid[last];
+    columns_.uid[slot] = columns_.uid[last];
+    columns_.user[slot] = columns_.user[last];
+    columns_.name[slot] = columns_.name[last];
+    columns_.cgroup[slot] = columns_.cgroup[last];
+    columns_.ticks[slot] = columns_.ticks[last];
+    columns_.cpu[slot] = columns_.cpu[last];
+    columns_.rssKb[slot] = columns_.rssKb[last];
+    columns_.io[slot] = columns_.io[last];
+    columns_.startTime[slot] = columns_.startTime[last];
+    slots_[entries_[slot].Pid()] = slot;
+  }
+  entries_.pop_back();
+  seen_.pop_back();
+  nodes_.pop_back();
+  columns_.pid.pop_back();
+  columns_.ppid.pop_back();
+  columns_.uid.pop_back();
+  columns_.user.pop_back();
+  columns_.name.pop_back();
+  columns_.cgroup.pop_back();
+  columns_.ticks.pop_back();
+  columns_.cpu.pop_back();
+  columns_.rssKb.pop_back();
+  columns_.io.pop_back();
+  columns_.startTime.pop_back();
+}
+
+// The name id of comm, counting one more entry with it
+std::uint32_t ProcessTable::NameId(std::string_view comm) {
+  std::uint32_t id{names_.Id(comm)};
+  if (id >= nameEntries_.size()) {
+    nameEntries_.resize(id + 1, 0);
+  }
+  ++nameEntries_[id];
+  return id;
+}
+
+// One entry less has the name; the last one gives its id back
+void ProcessTable::DropName(std::uint32_t name) {
+  if (--nameEntries_[name] == 0) {
+    names_.Release(name);
+  }
+}
+
+std::uint32_t ProcessTable::UserId(int uid) {
+  if (uid < 0) {
+    return 0;
+  }
+  auto found = userIds_.find(uid);
+  if (found != userIds_.end()) {
+    return found->second;
+  }
+  auto id = static_cast<std::uint32_t>(uids_.size());
+  uids_.push_back(uid);
+  userIds_.emplace(uid, id);
+  return id;
+}
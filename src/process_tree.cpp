@@ -0,0 +1,237 @@
+#include "../include/process_tree.h"
+
+#include <algorithm>
+
+using std::size_t;
+using std::vector;
+
+ProcessTree::ProcessTree() : nodes_(1) {}
+
+// Hangs the new process under its parent, or under the root until the
+// parent is in the tree
+ProcessTree::Node ProcessTree::Add(int pid, int ppid,
+                                   unsigned long long startTime) {
+  Node node;
+  if (free_.empty()) {
+    node = static_cast<Node>(nodes_.size());
+    nodes_.emplace_back();
+  } else {
+    node = free_.back();
+    free_.pop_back();
+    nodes_[node] = Entry{};
+  }
+  nodes_[node].pid = pid;
+  nodes_[node].startTime = startTime;
+  pids_[pid] = node;
+  Reparent(node, ppid);
+  return node;
+}
+
+// The children move up to the root; the kernel has reparented them, which
+// the next Update() of each one picks up
+void ProcessTree::Remove(Node node) {
+  while (nodes_[node].first != kNone) {
+    Node child{nodes_[node].first};
+    Unlink(child);
+    Link(child, kRoot);
+  }
+  Unlink(node);
+  auto found = pids_.find(nodes_[node].pid);
+  if (found != pids_.end() && found->second == node) {
+    pids_.erase(found);
+  }
+  free_.push_back(node);
+}
+
+// Only a change marks the path to the root for Rollup(). A process still
+// waiting for its parent looks for it again.
+void ProcessTree::Update(Node node, int ppid, float cpu, long long rssKb) {
+  Entry& entry = nodes_[node];
+  if (ppid != entry.ppid || (entry.parent == kRoot && ppid > 0)) {
+    Reparent(node, ppid);
+  }
+  if (cpu != entry.cpu || rssKb != entry.rssKb) {
+    entry.cpu = cpu;
+    entry.rssKb = rssKb;
+    MarkDirty(node);
+  }
+}
+
+void ProcessTree::Toggle(int pid) {
+  auto found = pids_.find(pid);
+  if (found != pids_.end()) {
+    nodes_[found->second].collapsed = !nodes_[found->second].collapsed;
+    MarkDirty(found->second);
+  }
+}
+
+// Fills lines with up to n visible lines of the tree, skipping the first
+// offset, and returns how many lines the whole tree takes. Siblings are in
+// sort key order, CPU and memory by their subtree sums. Subtrees that end
+// before offset are skipped whole, by their line count.
+size_t ProcessTree::Flatten(SortKey key, size_t offset, size_t n,
+                            vector<TreeLine>& lines) {
+  Rollup(kRoot);
+  lines.clear();
+  Flatten(kRoot, key, 0, offset, n, lines);
+  return static_cast<size_t>(nodes_[kRoot].visible);
+}
+
+// Makes node the first child of parent
+void ProcessTree::Link(Node node, Node parent) {
+  Entry& entry = nodes_[node];
+  entry.parent = parent;
+  entry.previous = kNone;
+  entry.next = nodes_[parent].first;
+  if (entry.next != kNone) {
+    nodes_[entry.next].previous = node;
+  }
+  nodes_[parent].first = node;
+  ++nodes_[parent].children;
+  MarkDirty(parent);
+}
+
+void ProcessTree::Unlink(Node node) {
+  Entry& entry = nodes_[node];
+  if (entry.parent == kNone) {
+    return;
+  }
+  if (entry.previous != kNone) {
+    nodes_[entry.previous].next = entry.next;
+  } else {
+    nodes_[entry.parent].first = entry.next;
+  }
+  if (entry.next != kNone) {
+    nodes_[entry.next].previous = entry.previous;
+  }
+  --nodes_[entry.parent].children;
+  MarkDirty(entry.parent);
+  entry.parent = kNone;
+}
+
+// A parent that is missing, or would make a cycle, leaves node under the
+// root
+void ProcessTree::Reparent(Node node, int ppid) {
+  nodes_[node].ppid = ppid;
+  auto found = pids_.find(ppid);
+  Node parent{found != pids_.end() && ppid > 0 ? found->second : kRoot};
+  for (Node above{parent}; above != kRoot; above = nodes_[above].parent) {
+    if (above == node) {
+      parent = kRoot;
+      break;
+    }
+  }
+  if (parent != nodes_[node].parent) {
+    Unlink(node);
+    Link(node, parent);
+  }
+}
+
+// Stops at the first dirty node, whose ancestors are dirty already
+void ProcessTree::MarkDirty(Node node) {
+  while (node != kNone && !nodes_[node].dirty) {
+    nodes_[node].dirty = true;
+    node = nodes_[node].parent;
+  }
+}
+
+// Clean children keep their sums, so only dirty paths are walked down
+void ProcessTree::Rollup(Node node) {
+  if (!nodes_[node].dirty) {
+    return;
+  }
+  float cpu{nodes_[node].cpu};
+  long long rssKb{nodes_[node].rssKb};
+  int processes{node == kRoot ? 0 : 1};
+  int visible{0};
+  for (Node child{nodes_[node].first}; child != kNone;
+       child = nodes_[child].next) {
+    Rollup(child);
+    const Entry& entry = nodes_[child];
+    cpu += entry.subtreeCpu;
+    rssKb += entry.subtreeRssKb;
+    processes += entry.processes;
+    visible += entry.visible;
+  }
+  Entry& entry = nodes_[node];
+  entry.subtreeCpu = cpu;
+  entry.subtreeRssKb = rssKb;
+  entry.processes = processes;
+  entry.visible = (node == kRoot ? 0 : 1) + (entry.collapsed ? 0 : visible);
+  entry.dirty = false;
+}
+
+// The first k children of node in key order, ties by pid
+void ProcessTree::Children(Node node, SortKey key, size_t k,
+                           vector<Node>& children) const {
+  children.clear();
+  for (Node child{nodes_[node].first}; child != kNone;
+       child = nodes_[child].next) {
+    children.push_back(child);
+  }
+  const vector<Entry>& n = nodes_;
+  k = std::min(k, children.size());
+  auto sort = [&children, k](auto before) {
+    std::partial_sort(children.begin(), children.begin() + k,
+                      children.end(), before);
+    children.resize(k);
+  };
+  switch (key) {
+    case SortKey::kCpu:
+      sort([&n](Node a, Node b) {
+        return n[a].subtreeCpu != n[b].subtreeCpu
+                   ? n[a].subtreeCpu > n[b].subtreeCpu
+                   : n[a].pid < n[b].pid;
+      });
+      break;
+    case SortKey::kMemory:
+      sort([&n](Node a, Node b) {
+        return n[a].subtreeRssKb != n[b].subtreeRssKb
+                   ? n[a].subtreeRssKb > n[b].subtreeRssKb
+                   : n[a].pid < n[b].pid;
+      });
+      break;
+    case SortKey::kUpTime:
+      sort([&n](Node a, Node b) {
+        return n[a].startTime != n[b].startTime
+                   ? n[a].startTime < n[b].startTime
+                   : n[a].pid < n[b].pid;
+      });
+      break;
+    case SortKey::kPid:
+    case SortKey::kIo:  // I/O is not summed up the tree
+      sort([&n](Node a, Node b) { return n[a].pid < n[b].pid; });
+      break;
+  }
+}
+
+// The children of each depth are sorted into a vector kept for that
+// depth, so flattening stops allocating once the deepest path was seen.
+// Every child takes at least one line, so no more children than lines
+// still to skip or fill are sorted.
+void ProcessTree::Flatten(Node node, SortKey key, int depth, size_t& skip,
+                          size_t n, vector<TreeLine>& lines) {
+  if (children_.size() <= static_cast<size_t>(depth)) {
+    children_.resize(depth + 1);
+  }
+  Children(node, key, skip + n - lines.size(), children_[depth]);
+  // Indexed, since deeper calls may grow children_
+  for (size_t i{0}; i < children_[depth].size() && lines.size() < n; ++i) {
+    Node child{children_[depth][i]};
+    const Entry& entry = nodes_[child];
+    if (skip >= static_cast<size_t>(entry.visible)) {
+      skip -= entry.visible;
+      continue;
+    }
+    if (skip > 0) {
+      --skip;
+    } else {
+      lines.push_back({entry.pid, depth, entry.children > 0, entry.collapsed,
+                       entry.processes, entry.subtreeCpu,
+                       entry.subtreeRssKb});
+    }
+    if (!entry.collapsed) {
+      Flatten(child, key, depth + 1, skip, n, lines);
+    }
+  }
+}
@@ -4,8 +4,47 @@
 
 #include "../include/linux_parser.h"
 
+// Replaces the previous sample with times and computes the utilization of
+// the interval in between. Guest time is already accounted in user and
+// nice, so it is left out of the total. The very first sample has nothing
+// to compare against and reports the average since boot.
+void Processor::Advance(Sample& sample,
+                        const SystemSnapshot::CpuTimes& times) {
+  long long idle = times.jiffies[LinuxParser::kIdle_] +
+                   times.jiffies[LinuxParser::kIOwait_];
+  long long total{0};
+  for (int state{LinuxParser::kUser_}; state <= LinuxParser::kSteal_; ++state) {
+    total += times.jiffies[state];
+  }
+  long long active = total - idle;
+
+  long long deltaTotal = total - sample.total;
+  long long deltaActive = active - sample.active;
+  if (deltaTotal > 0 && deltaActive >= 0) {
+    sample.utilization = (deltaActive * 1.0) / (deltaTotal * 1.0);
+  }
+  sample.active = active;
+  sample.total = total;
+}
+
+// Takes the cpu lines of the current snapshot
+void Processor::Update(const SystemSnapshot& snapshot) {
+  Advance(aggregate_, snapshot.cpu);
+
+  if (cores_.size() < snapshot.cores.size()) {
+    cores_.resize(snapshot.cores.size());
+  }
+  coreCount_ = snapshot.coreCount;
+  for (int core{0}; core < coreCount_; ++core) {
+    Advance(cores_[core], snapshot.cores[core]);
+  }
+}
+
 // TODO: Return the aggregate CPU utilization
-float Processor::Utilization() {
+float Processor::Utilization() { return aggregate_.utilization; }
+
+int Processor::CoreCount() const { return coreCount_; }
 
-  return (LinuxParser::ActiveJiffies() * 1.0) / (LinuxParser::Jiffies() * 1.0); 
-}
\ No newline at end of file
+float Processor::CoreUtilization(int core) const {
+  return core < coreCount_ ? cores_[core].utilization : 0.0;
+}
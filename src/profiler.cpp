@@ -0,0 +1,158 @@
+#include "../include/profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+using std::size_t;
+using std::string;
+
+// Replacing the global allocation functions is what lets the profiler
+// count allocations in every module without touching them. The cost is
+// one relaxed atomic add per allocation.
+void* operator new(size_t size) {
+  Profiler::CountAllocation();
+  if (void* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t align) {
+  Profiler::CountAllocation();
+  size_t alignment = static_cast<size_t>(align);
+  size = (size + alignment - 1) / alignment * alignment;
+  if (void* p = std::aligned_alloc(alignment, size == 0 ? alignment : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+Profiler::ChargeTo::ChargeTo(Counters* counters) : previous_(charged_) {
+  charged_ = counters;
+}
+
+Profiler::ChargeTo::~ChargeTo() { charged_ = previous_; }
+
+Profiler::Scope::Scope(Profiler& profiler, Phase phase)
+    : profiler_(profiler),
+      phase_(phase),
+      start_(std::chrono::steady_clock::now()),
+      allocations_(Allocations()),
+      syscalls_(Syscalls()) {}
+
+// Adds rather than stores, so a phase entered several times in a tick,
+// like one user lookup per row, reports the sum
+Profiler::Scope::~Scope() {
+  auto& values = profiler_.current_[static_cast<int>(phase_)];
+  values[static_cast<int>(Counter::kTime)] +=
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start_)
+          .count();
+  values[static_cast<int>(Counter::kAllocations)] +=
+      Allocations() - allocations_;
+  values[static_cast<int>(Counter::kSyscalls)] += Syscalls() - syscalls_;
+}
+
+// Of the calling thread, and the threads working for it
+long long Profiler::Allocations() {
+  return ThreadCounters()->allocations.load(std::memory_order_relaxed);
+}
+
+long long Profiler::Syscalls() {
+  return ThreadCounters()->syscalls.load(std::memory_order_relaxed);
+}
+
+const char* Profiler::Name(Phase phase) {
+  switch (phase) {
+    case Phase::kTick: return "tick";
+    case Phase::kSnapshot: return "snapshot";
+    case Phase::kPids: return "pids";
+    case Phase::kScan: return "scan";
+    case Phase::kSort: return "sort";
+    case Phase::kStatus: return "status";
+    case Phase::kSmaps: return "smaps";
+    case Phase::kUsers: return "users";
+    case Phase::kCgroups: return "cgroups";
+    case Phase::kThreads: return "threads";
+    case Phase::kOutput: return "output";
+    default: return "";
+  }
+}
+
+// Moves the current tick into the window, overwriting the oldest
+void Profiler::EndTick() {
+  window_[ticks_ % kWindow] = current_;
+  ++ticks_;
+  current_ = {};
+}
+
+size_t Profiler::Ticks() const { return std::min(ticks_, kWindow); }
+
+// Percentiles by selection over a reused copy of the window
+Profiler::Summary Profiler::Get(Phase phase, Counter counter) const {
+  size_t ticks{Ticks()};
+  if (ticks == 0) {
+    return {0, 0, 0};
+  }
+  int p{static_cast<int>(phase)};
+  int c{static_cast<int>(counter)};
+  scratch_.resize(ticks);
+  for (size_t i{0}; i < ticks; ++i) {
+    scratch_[i] = window_[i][p][c];
+  }
+  Summary summary{};
+  summary.last = window_[(ticks_ - 1) % kWindow][p][c];
+  auto median = scratch_.begin() + ticks / 2;
+  std::nth_element(scratch_.begin(), median, scratch_.end());
+  summary.p50 = *median;
+  auto tail = scratch_.begin() + std::min(ticks - 1, ticks * 99 / 100);
+  std::nth_element(scratch_.begin(), tail, scratch_.end());
+  summary.p99 = *tail;
+  return summary;
+}
+
+void Profiler::Get(Report& report) const {
+  report.ticks = Ticks();
+  for (int p{0}; p < kPhases; ++p) {
+    for (int c{0}; c < kCounters; ++c) {
+      report.values[p][c] =
+          Get(static_cast<Phase>(p), static_cast<Counter>(c));
+    }
+  }
+}
+
+// {"tick":{"time_ns":[last,p50,p99],"allocations":[...],"syscalls":[...]},
+//  "snapshot":{...},...}
+void Profiler::AppendJson(string& out) const {
+  static const char* const counters[] = {"time_ns", "allocations",
+                                         "syscalls"};
+  char number[96];
+  out += '{';
+  for (int p{0}; p < kPhases; ++p) {
+    Phase phase{static_cast<Phase>(p)};
+    out += p > 0 ? ",\"" : "\"";
+    out += Name(phase);
+    out += "\":{";
+    for (int c{0}; c < kCounters; ++c) {
+      Summary summary{Get(phase, static_cast<Counter>(c))};
+      std::snprintf(number, sizeof(number), "%s\"%s\":[%lld,%lld,%lld]",
+                    c > 0 ? "," : "", counters[c], summary.last, summary.p50,
+                    summary.p99);
+      out += number;
+    }
+    out += '}';
+  }
+  out += '}';
+}
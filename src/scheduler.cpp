@@ -0,0 +1,31 @@
+#include "../include/scheduler.h"
+
+#include <algorithm>
+
+bool Scheduler::Due(Tier tier, Clock::time_point now) const {
+  return now >= due_[static_cast<int>(tier)];
+}
+
+// The next refresh is counted from now rather than from when this one was
+// due, so a slow tick does not cause a burst of catching up
+void Scheduler::Done(Tier tier, Clock::time_point now, Clock::duration cost) {
+  int t{static_cast<int>(tier)};
+  if (tier == Tier::kScan) {
+    intervals_[t] = std::clamp<Clock::duration>(cost * kScanShare,
+                                                kMinScanInterval,
+                                                kMaxScanInterval);
+  }
+  due_[t] = now + intervals_[t];
+}
+
+void Scheduler::Expedite(Tier tier) {
+  due_[static_cast<int>(tier)] = Clock::time_point{};
+}
+
+Scheduler::Clock::duration Scheduler::Interval(Tier tier) const {
+  return intervals_[static_cast<int>(tier)];
+}
+
+Scheduler::Clock::time_point Scheduler::Next() const {
+  return *std::min_element(due_.begin(), due_.end());
+}
@@ -0,0 +1,37 @@
+#include "../include/string_pool.h"
+
+std::string_view StringPool::Intern(std::string_view text) {
+  return strings_[Id(text)];
+}
+
+std::uint32_t StringPool::Id(std::string_view text) {
+  auto found = index_.find(text);
+  if (found != index_.end()) {
+    return found->second;
+  }
+  std::uint32_t id;
+  if (free_.empty()) {
+    id = static_cast<std::uint32_t>(strings_.size());
+    strings_.emplace_back(text);
+  } else {
+    id = free_.back();
+    free_.pop_back();
+    strings_[id].assign(text.data(), text.size());
+  }
+  index_.emplace(strings_[id], id);
+  return id;
+}
+
+std::string_view StringPool::Get(std::uint32_t id) const {
+  return strings_[id];
+}
+
+// Views of the string become invalid. The memory of a long string is
+// returned, a short one lives inside its std::string anyway.
+void StringPool::Release(std::uint32_t id) {
+  index_.erase(strings_[id]);
+  std::string().swap(strings_[id]);
+  free_.push_back(id);
+}
+
+std::size_t StringPool::Size() const { return strings_.size(); }
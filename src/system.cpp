@@ -1,8 +1,13 @@
 #include "../include/system.h"
 #include <unistd.h>
+#include <algorithm>
+#include <chrono>
 #include <cstddef>
+#include <cstdio>
+#include <cstring>
 #include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 #include "../include/linux_parser.h"
 #include "../include/process.h"
@@ -14,40 +19,665 @@ using std::size_t;
 using std::string;
 using std::vector;
 
+namespace {
+// Copies text into a fixed field, cutting it to fit
+void CopyText(char* to, size_t size, std::string_view text) {
+  size_t length = std::min(text.size(), size - 1);
+  std::memcpy(to, text.data(), length);
+  to[length] = '\0';
+}
+}  // namespace
+
+System::System(int scanThreads) : scanner_(scanThreads) {}
+
+// Switches process discovery to the proc connector. Returns false, and
+// keeps scanning /proc, if the connector is not available.
+bool System::UseProcConnector() {
+  auto connector = std::make_unique<ProcConnector>();
+  if (!connector->Start()) {
+    return false;
+  }
+  connector_ = std::move(connector);
+  return true;
+}
+
+// Takes one snapshot of the system wide counters for the current tick,
+// disk and network counters included
+void System::Refresh() {
+  Profiler::Scope scope(profiler_, Profiler::Phase::kSnapshot);
+  snapshot_.Refresh();
+  cpu_.Update(snapshot_);
+  devices_.Refresh();
+}
+
+// Refreshes and copies the system figures and the top n processes into
+// frame, reusing the storage it already has
+void System::Collect(Frame& frame, size_t n) {
+  Refresh();
+  CollectSystem(frame);
+  ScanProcesses();
+  Rank(n);
+  CollectProcesses(frame);
+}
+
+// Runs the tiers of scheduler that are due at now: the system figures,
+// the full scan or else the rows shown, then the top n again. What is
+// not due keeps its last values for CollectSystem() and
+// CollectProcesses(). Returns true if the rows were refreshed.
+bool System::RefreshDue(Scheduler& scheduler,
+                        Scheduler::Clock::time_point now, size_t n) {
+  using Tier = Scheduler::Tier;
+  if (scheduler.Due(Tier::kSystem, now)) {
+    Refresh();
+    scheduler.Done(Tier::kSystem, now, {});
+  }
+  bool rows{false};
+  if (scheduler.Due(Tier::kScan, now)) {
+    ScanProcesses();
+    auto scanned = Scheduler::Clock::now();
+    scheduler.Done(Tier::kScan, scanned, scanned - now);
+    rows = true;
+  } else if (scheduler.Due(Tier::kRows, now) && !RefreshRows()) {
+    scheduler.Expedite(Tier::kScan);  // drop the rows that exited
+  }
+  if (rows || scheduler.Due(Tier::kRows, now)) {
+    Rank(n);
+    scheduler.Done(Tier::kRows, now, {});
+    rows = true;
+  }
+  return rows;
+}
+
+// Copies the system figures of the last Refresh() into frame. The OS and
+// kernel names do not change while running and are only read once.
+void System::CollectSystem(Frame& frame) {
+  frame.timestampMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                          std::chrono::system_clock::now().time_since_epoch())
+                          .count();
+  if (os_.empty()) {
+    os_ = OperatingSystem();
+    kernel_ = Kernel();
+  }
+  std::snprintf(frame.os, sizeof(frame.os), "%s", os_.c_str());
+  std::snprintf(frame.kernel, sizeof(frame.kernel), "%s", kernel_.c_str());
+  frame.cpu = cpu_.Utilization();
+  frame.cores.resize(cpu_.CoreCount());
+  for (int core{0}; core < cpu_.CoreCount(); ++core) {
+    frame.cores[core] = cpu_.CoreUtilization(core);
+  }
+  frame.memory = MemoryUtilization();
+  frame.totalProcesses = TotalProcesses();
+  frame.runningProcesses = RunningProcesses();
+  frame.shortLivedProcesses = ShortLivedProcesses();
+  frame.upTime = UpTime();
+  for (int period{0}; period < 3; ++period) {
+    frame.loadAverage[period] = LoadAverage(period);
+  }
+  CollectDevices(frame);
+}
+
+// The devices of the last Refresh(), busiest first: disks by the bytes
+// read and written, interfaces by the bytes received and sent. Ties stay
+// in the order of the /proc files.
+void System::CollectDevices(Frame& frame) {
+  const vector<DiskStat>& disks = devices_.Disks();
+  diskOrder_.resize(disks.size());
+  for (size_t i{0}; i < disks.size(); ++i) {
+    diskOrder_[i] = i;
+  }
+  std::sort(diskOrder_.begin(), diskOrder_.end(),
+            [&disks](size_t a, size_t b) {
+              double bytesA{disks[a].readBytesPerSecond +
+                            disks[a].writeBytesPerSecond};
+              double bytesB{disks[b].readBytesPerSecond +
+                            disks[b].writeBytesPerSecond};
+              return bytesA != bytesB ? bytesA > bytesB : a < b;
+            });
+  frame.disks.resize(disks.size());
+  for (size_t i{0}; i < disks.size(); ++i) {
+    const DiskStat& disk = disks[diskOrder_[i]];
+    DiskRow& row = frame.disks[i];
+    CopyText(row.name, sizeof(row.name), devices_.Name(disk.name));
+    row.readsPerSecond = static_cast<float>(disk.readsPerSecond);
+    row.writesPerSecond = static_cast<float>(disk.writesPerSecond);
+    row.readKbPerSecond = static_cast<long>(disk.readBytesPerSecond / 1024);
+    row.writeKbPerSecond =
+        static_cast<long>(disk.writeBytesPerSecond / 1024);
+    row.utilization = disk.utilization;
+    row.queueDepth = disk.queueDepth;
+  }
+
+  const vector<NetStat>& networks = devices_.Networks();
+  netOrder_.resize(networks.size());
+  for (size_t i{0}; i < networks.size(); ++i) {
+    netOrder_[i] = i;
+  }
+  std::sort(netOrder_.begin(), netOrder_.end(),
+            [&networks](size_t a, size_t b) {
+              double bytesA{networks[a].rxBytesPerSecond +
+                            networks[a].txBytesPerSecond};
+              double bytesB{networks[b].rxBytesPerSecond +
+                            networks[b].txBytesPerSecond};
+              return bytesA != bytesB ? bytesA > bytesB : a < b;
+            });
+  frame.networks.resize(networks.size());
+  for (size_t i{0}; i < networks.size(); ++i) {
+    const NetStat& network = networks[netOrder_[i]];
+    NetRow& row = frame.networks[i];
+    CopyText(row.name, sizeof(row.name), devices_.Name(network.name));
+    row.rxKbPerSecond = static_cast<long>(network.rxBytesPerSecond / 1024);
+    row.txKbPerSecond = static_cast<long>(network.txBytesPerSecond / 1024);
+    row.rxPacketsPerSecond = static_cast<float>(network.rxPacketsPerSecond);
+    row.txPacketsPerSecond = static_cast<float>(network.txPacketsPerSecond);
+    row.rxDropsPerSecond = static_cast<float>(network.rxDropsPerSecond);
+    row.txDropsPerSecond = static_cast<float>(network.txDropsPerSecond);
+  }
+}
+
+// Copies the processes of the last Rank() into frame, and the top groups
+// when grouped. Only copies, so a frame can be filled again from the
+// same Rank().
+void System::CollectProcesses(Frame& frame) {
+  CollectGroups(frame);
+  CollectTree(frame);
+  CollectThreads(frame);
+  vector<Process*>& processes = processes_;
+  bool io{columns_.io || SortsByIo()};
+  frame.sortKey = sortKey_;
+  frame.columns = columns_;
+  frame.columns.io = io;
+  frame.rows.resize(processes.size());
+  for (size_t i{0}; i < processes.size(); ++i) {
+    Process& process = *processes[i];
+    ProcessRow& row = frame.rows[i];
+    row.pid = process.Pid();
+    row.cpu = process.CpuUtilization();
+    row.rssMb = process.RamMb();
+    row.pssMb = columns_.smaps ? process.PssMb() : -1;
+    row.sharedMb = columns_.smaps ? process.SharedMb() : -1;
+    row.privateMb = columns_.smaps ? process.PrivateMb() : -1;
+    row.swapMb = columns_.swap ? process.SwapMb() : -1;
+    row.readKbPerSecond = io ? process.ReadKbPerSecond() : -1;
+    row.writeKbPerSecond = io ? process.WriteKbPerSecond() : -1;
+    row.readCallsPerSecond = io ? process.ReadCallsPerSecond() : -1;
+    row.writeCallsPerSecond = io ? process.WriteCallsPerSecond() : -1;
+    row.upTime = process.UpTime();
+    CopyText(row.user, sizeof(row.user),
+             columns_.user ? process.CachedUser() : std::string_view{});
+    CopyText(row.command, sizeof(row.command),
+             columns_.command ? process.CachedCommand() : std::string_view{});
+  }
+}
+
+// The snapshot the one thread that collects fills in place, until
+// Publish(). It holds an older snapshot, so every part of it has to be
+// filled again; its storage is reused.
+Snapshot& System::Back() { return snapshots_.Back(); }
+
+// Makes Back() the newest snapshot
+void System::Publish() { snapshots_.Publish(); }
+
+// The newest complete snapshot, for the one thread that renders. Never
+// blocks, and what it returns stays unchanged until the next call.
+const Snapshot& System::Latest() {
+  snapshots_.Update();
+  return snapshots_.Front();
+}
+
+// Sums every process of the table into its group and orders as many of
+// the top groups as there are rows, in sort key order: CPU and memory
+// order by their sums, the others by the number of processes
+void System::RankGroups() {
+  Profiler::Scope scope(profiler_, Profiler::Phase::kSort);
+  table_.Aggregate(groupBy_, groups_);
+  if (groupBy_ == GroupBy::kCgroup) {
+    RankCgroups(processes_.size());
+    return;
+  }
+  size_t n{std::min(groups_.size(), processes_.size())};
+  SortKey key{sortKey_};
+  std::partial_sort(
+      groups_.begin(), groups_.begin() + n, groups_.end(),
+      [key](const ProcessGroup& a, const ProcessGroup& b) {
+        switch (key) {
+          case SortKey::kCpu: return a.cpu > b.cpu;
+          case SortKey::kMemory: return a.rssKb > b.rssKb;
+          default: return a.processes > b.processes;
+        }
+      });
+}
+
+// The top groups of the last Rank()
+void System::CollectGroups(Frame& frame) {
+  frame.groupBy = groupBy_;
+  if (groupBy_ == GroupBy::kCgroup) {
+    frame.groups.clear();
+    CollectCgroups(frame);
+    return;
+  }
+  frame.cgroups.clear();
+  size_t n{std::min(groups_.size(), processes_.size())};
+  frame.groups.resize(n);
+  for (size_t i{0}; i < n; ++i) {
+    const ProcessGroup& group = groups_[i];
+    GroupRow& row = frame.groups[i];
+    if (groupBy_ == GroupBy::kCommand) {
+      CopyText(row.name, sizeof(row.name), table_.Name(group.id));
+    } else if (table_.UserUid(group.id) < 0) {
+      CopyText(row.name, sizeof(row.name), "?");
+    } else {
+      Profiler::Scope users(profiler_, Profiler::Phase::kUsers);
+      CopyText(row.name, sizeof(row.name),
+               strings_.Intern(
+                   LinuxParser::UserName(table_.UserUid(group.id))));
+    }
+    row.processes = group.processes;
+    row.cpu = group.cpu;
+    row.rssMb = static_cast<long>(group.rssKb / 1024);
+  }
+}
+
+// Orders the top n cgroups by their own counters, in sort key order like
+// the other groups, I/O by the bytes read and written, and counts how
+// many processes each holds directly. The counters were read by Rank().
+void System::RankCgroups(size_t n) {
+  cgroupProcesses_.assign(cgroups_.Paths(), 0);
+  for (const ProcessGroup& group : groups_) {
+    if (group.id < cgroupProcesses_.size()) {
+      cgroupProcesses_[group.id] = group.processes;
+    }
+  }
+  const vector<Cgroup>& cgroups = cgroups_.Groups();
+  cgroupOrder_.resize(cgroups.size());
+  for (size_t i{0}; i < cgroups.size(); ++i) {
+    cgroupOrder_[i] = i;
+  }
+  n = std::min(n, cgroups.size());
+  SortKey key{sortKey_};
+  const vector<int>& processes = cgroupProcesses_;
+  std::partial_sort(
+      cgroupOrder_.begin(), cgroupOrder_.begin() + n, cgroupOrder_.end(),
+      [key, &cgroups, &processes](size_t a, size_t b) {
+        switch (key) {
+          case SortKey::kCpu: return cgroups[a].cpu > cgroups[b].cpu;
+          case SortKey::kMemory:
+            return cgroups[a].counters.memoryCurrent >
+                   cgroups[b].counters.memoryCurrent;
+          case SortKey::kIo:
+            return cgroups[a].readBytesPerSecond +
+                       cgroups[a].writeBytesPerSecond >
+                   cgroups[b].readBytesPerSecond +
+                       cgroups[b].writeBytesPerSecond;
+          default:
+            return processes[cgroups[a].path] > processes[cgroups[b].path];
+        }
+      });
+}
+
+// The top cgroups of the last Rank()
+void System::CollectCgroups(Frame& frame) {
+  const vector<Cgroup>& cgroups = cgroups_.Groups();
+  const vector<int>& processes = cgroupProcesses_;
+  size_t n{std::min(processes_.size(), cgroups.size())};
+  frame.cgroups.resize(n);
+  for (size_t i{0}; i < n; ++i) {
+    const Cgroup& cgroup = cgroups[cgroupOrder_[i]];
+    CgroupRow& row = frame.cgroups[i];
+    CopyText(row.path, sizeof(row.path), cgroups_.Path(cgroup.path));
+    row.processes = processes[cgroup.path];
+    row.cpu = cgroup.cpu;
+    row.throttled = cgroup.throttled;
+    row.memoryMb = static_cast<long>(cgroup.counters.memoryCurrent >> 20);
+    row.anonMb = static_cast<long>(cgroup.counters.anon >> 20);
+    row.fileMb = static_cast<long>(cgroup.counters.file >> 20);
+    row.readKbPerSecond = static_cast<long>(cgroup.readBytesPerSecond / 1024);
+    row.writeKbPerSecond =
+        static_cast<long>(cgroup.writeBytesPerSecond / 1024);
+  }
+}
+
+// The place of each row in the tree and the sums of its subtree, in tree
+// view
+void System::CollectTree(Frame& frame) {
+  frame.treeView = treeView_;
+  frame.treeOffset = treeView_ ? static_cast<long>(treeShown_) : 0;
+  frame.treeSize = treeView_ ? static_cast<long>(treeSize_) : 0;
+  frame.tree.resize(treeView_ ? treeLines_.size() : 0);
+  for (size_t i{0}; i < frame.tree.size(); ++i) {
+    const TreeLine& line = treeLines_[i];
+    TreeRow& row = frame.tree[i];
+    row.depth = line.depth;
+    row.children = line.children;
+    row.collapsed = line.collapsed;
+    row.processes = line.processes;
+    row.cpu = line.cpu;
+    row.rssMb = static_cast<long>(line.rssKb / 1024);
+  }
+}
+
+// Orders as many threads as there are rows in sort key order: by tid
+// when sorting by pid, by CPU otherwise, since threads share their
+// process' memory and start time
+void System::RankThreads() {
+  const vector<Thread>& threads = threads_.Threads();
+  size_t n{std::min(threads.size(), processes_.size())};
+  threadOrder_.resize(threads.size());
+  for (size_t i{0}; i < threads.size(); ++i) {
+    threadOrder_[i] = i;
+  }
+  bool byTid{sortKey_ == SortKey::kPid};
+  std::partial_sort(threadOrder_.begin(), threadOrder_.begin() + n,
+                    threadOrder_.end(), [byTid, &threads](size_t a, size_t b) {
+                      if (!byTid && threads[a].cpu != threads[b].cpu) {
+                        return threads[a].cpu > threads[b].cpu;
+                      }
+                      return threads[a].tid < threads[b].tid;
+                    });
+}
+
+// The top threads of the last Rank()
+void System::CollectThreads(Frame& frame) {
+  frame.threadView = threadView_;
+  frame.threadPid = threadView_ ? threadPid_ : 0;
+  if (!threadView_) {
+    frame.threads.clear();
+    return;
+  }
+  const vector<Thread>& threads = threads_.Threads();
+  size_t n{std::min(threads.size(), processes_.size())};
+  frame.threads.resize(n);
+  for (size_t i{0}; i < n; ++i) {
+    const Thread& thread = threads[threadOrder_[i]];
+    ThreadRow& row = frame.threads[i];
+    row.pid = thread.pid;
+    row.tid = thread.tid;
+    row.cpu = thread.cpu;
+    row.state = thread.state;
+    row.processor = thread.processor;
+    CopyText(row.name, sizeof(row.name), thread.name);
+  }
+}
+
 // TODO: Return the system's CPU
 Processor& System::Cpu() { return cpu_; }
 
-// TODO: Return a container composed of the system's processes
-vector<Process>& System::Processes() { 
-    
-    std::vector<int> vec{LinuxParser::Pids()};
+// Samples every process, finding the ones that started or exited. stat,
+// which holds every other sort key, is read for every process, as is
+// status when grouping by user and io when sorting by I/O; the rest is
+// read for the rows shown by Rank(). Grouped by cgroup, the cgroups that
+// were created or removed are found as well. Pointers returned by an
+// earlier Rank() are invalid afterwards.
+void System::ScanProcesses() {
+  {
+    Profiler::Scope scope(profiler_, Profiler::Phase::kPids);
+    if (connector_) {
+      connector_->Pids(pids_);
+    } else {
+      LinuxParser::Pids(pids_);
+    }
+  }
+  Profiler::Scope scope(profiler_, Profiler::Phase::kScan);
+  scanner_.Scan(pids_, samples_, groupBy_ == GroupBy::kUser, SortsByIo());
+  table_.Update(pids_, samples_, snapshot_.upTime);
+  CompactStrings();
+  if (groupBy_ == GroupBy::kCgroup) {
+    Profiler::Scope cgroups(profiler_, Profiler::Phase::kCgroups);
+    cgroupsFound_ = cgroups_.Scan();
+    if (cgroupsFound_) {
+      ReadCgroups();
+    }
+  }
+}
+
+// The commands and user names of processes that exited, or that exec()
+// renamed, stay in strings_. Once it has grown to twice what the live
+// processes held after the last compaction, what they hold now is
+// interned into a fresh pool that replaces it, so the pool stays within
+// a constant factor of the live strings at O(1) amortized cost per
+// string interned.
+void System::CompactStrings() {
+  if (strings_.Size() < 2 * std::max(keptStrings_, kMinCompactStrings)) {
+    return;
+  }
+  StringPool kept;
+  for (Process& process : table_.Entries()) {
+    if (process.HasCommand()) {
+      process.SetCommand(kept.Intern(process.CachedCommand()));
+    }
+    if (process.HasUser()) {
+      process.SetUser(kept.Intern(process.CachedUser()));
+    } else {
+      process.ClearUser();  // of a uid it no longer has
+    }
+  }
+  strings_ = std::move(kept);
+  keptStrings_ = strings_.Size();
+}
+
+// Samples again only the processes of the last Rank(), whose files are
+// kept open, so their figures stay current between full scans. Returns
+// false if one of them exited, which only a full scan removes.
+bool System::RefreshRows() {
+  Profiler::Scope scope(profiler_, Profiler::Phase::kScan);
+  scanner_.Scan(topPids_, topSamples_, false, SortsByIo());
+  table_.Resample(topPids_, topSamples_, snapshot_.upTime);
+  return std::all_of(topSamples_.begin(), topSamples_.end(),
+                     [](const ProcSample& sample) { return sample.ok; });
+}
+
+// Returns the first n processes of the table in sort key order, then
+// reads the status and memory details of those rows, the counters of
+// every cgroup when grouped by cgroup, and threads in thread view. A
+// bounded partial sort keeps the cost at O(P log n) instead of sorting the
+// whole table.
+size_t System::Rank(size_t n) {
+  if (treeView_) {
+    RankTree(n);
+  } else {
+    Profiler::Scope scope(profiler_, Profiler::Phase::kSort);
+    table_.Top(sortKey_, n, top_);
     processes_.clear();
+    for (size_t index : top_) {
+      processes_.push_back(&table_.Entries()[index]);
+    }
+  }
+
+  topPids_.clear();
+  for (auto* process : processes_) {
+    topPids_.push_back(process->Pid());
+  }
+  scanner_.KeepOpen(topPids_);
+  ReadRows();
+  if (columns_.smaps) {
+    ReadSmaps();
+  }
+  if (groupBy_ == GroupBy::kCgroup && cgroupsFound_) {
+    Profiler::Scope cgroups(profiler_, Profiler::Phase::kCgroups);
+    cgroups_.Refresh();
+  }
+  if (threadView_) {
+    ReadThreads();
+    RankThreads();
+  }
+  RankGroups();
+  return processes_.size();
+}
+
+// The cgroup of each process not mapped yet, from /proc/[pid]/cgroup.
+// Processes rarely move once started, so each is only read once, and
+// again when the group it was in is gone: it can only have been removed
+// after the process moved out, and its id may be another group's now.
+void System::ReadCgroups() {
+  const ProcessColumns& columns = table_.Columns();
+  char path[4096];
+  for (size_t i{0}; i < columns.pid.size(); ++i) {
+    if (cgroups_.Known(columns.cgroup[i])) {
+      continue;
+    }
+    size_t length = LinuxParser::ProcCgroup(columns.pid[i], path,
+                                            sizeof(path));
+    table_.SetCgroup(i, length > 0 ? cgroups_.Id({path, length}) : 0);
+  }
+}
+
+// In tree view the rows are n lines of the flattened tree, from the
+// offset asked for, or as close to it as still leaves n lines to show
+// after subtrees were collapsed
+void System::RankTree(size_t n) {
+  Profiler::Scope scope(profiler_, Profiler::Phase::kSort);
+  ProcessTree& tree = table_.Tree();
+  treeShown_ = treeOffset_;
+  treeSize_ = tree.Flatten(sortKey_, treeShown_, n, treeLines_);
+  if (treeLines_.size() < n && treeShown_ > 0) {
+    treeShown_ = treeSize_ > n ? treeSize_ - n : 0;
+    tree.Flatten(sortKey_, treeShown_, n, treeLines_);
+  }
+  processes_.clear();
+  for (const TreeLine& line : treeLines_) {
+    processes_.push_back(table_.Find(line.pid));
+  }
+}
+
+// The threads of the rows shown, or of the one process asked for. Only
+// these are listed, the cost of a host's other threads is never paid.
+void System::ReadThreads() {
+  Profiler::Scope scope(profiler_, Profiler::Phase::kThreads);
+  threadProcesses_.clear();
+  if (threadPid_ == 0) {
+    threadProcesses_.assign(processes_.begin(), processes_.end());
+  } else if (Process* process = table_.Find(threadPid_)) {
+    threadProcesses_.push_back(process);
+  }
+  threads_.Read(threadProcesses_, snapshot_.upTime);
+}
+
+// Reads what the active columns need of the rows shown. Status and io
+// change, so they are read every time, io unless the scan already read
+// it; the command and user name are only looked up once per process, and
+// interned.
+void System::ReadRows() {
+  Profiler::Scope scope(profiler_, Profiler::Phase::kStatus);
+  LinuxParser::ProcStatusRecord status;
+  LinuxParser::ProcIoRecord io;
+  char command[4096];
+  bool readIo{columns_.io && !SortsByIo()};
+  for (auto* process : processes_) {
+    if ((columns_.user || columns_.swap) &&
+        scanner_.ReadStatus(process->Pid(), status)) {
+      process->UpdateStatus(status);
+    }
+    if (readIo) {
+      bool ok{scanner_.ReadIo(process->Pid(), io)};
+      process->UpdateIo(ok ? &io : nullptr, Process::Clock::now());
+    }
+    if (columns_.command && !process->HasCommand()) {
+      std::size_t length =
+          LinuxParser::Command(process->Pid(), command, sizeof(command));
+      process->SetCommand(strings_.Intern({command, length}));
+    }
+    if (columns_.user && !process->HasUser() && process->Uid() >= 0) {
+      Profiler::Scope users(profiler_, Profiler::Phase::kUsers);
+      process->SetUser(strings_.Intern(LinuxParser::UserName(process->Uid())));
+    }
+  }
+}
 
-    for (const auto& v : vec) {
-        Process process(v);
-        processes_.emplace_back(process);
+// smaps_rollup of the rows shown whose copy expired. Its cost grows with
+// the size of the process, so each is kept for kSmapsCostShare times what
+// reading it took, within kMinSmapsTtl and kMaxSmapsTtl.
+void System::ReadSmaps() {
+  Profiler::Scope scope(profiler_, Profiler::Phase::kSmaps);
+  LinuxParser::SmapsRollupRecord smaps;
+  for (auto* process : processes_) {
+    auto now = Process::Clock::now();
+    if (!process->SmapsExpired(now)) {
+      continue;
     }
+    bool ok{LinuxParser::ParseSmapsRollup(process->Pid(), smaps)};
+    auto read = Process::Clock::now();
+    auto ttl = std::clamp<Process::Clock::duration>(
+        (read - now) * kSmapsCostShare, kMinSmapsTtl, kMaxSmapsTtl);
+    process->UpdateSmaps(ok ? &smaps : nullptr, read + ttl);
+  }
+}
+
+SortKey System::GetSortKey() const { return sortKey_; }
 
-    std::sort(processes_.begin(), processes_.end(),[](Process& p1, Process& p2){ 
-        return (p1<p2);});
-    
-    return processes_;
+// io is one more file per process, which may be denied, so it is only
+// read for every process when the rows are the top processes by I/O. In
+// tree view siblings are not ordered by it.
+bool System::SortsByIo() const {
+  return sortKey_ == SortKey::kIo && !treeView_;
 }
 
+GroupBy System::GetGroupBy() const { return groupBy_; }
+
+// Grouping by user needs the uid of every process, which makes each full
+// scan read status as well. Grouping by cgroup reads the cgroup of every
+// new process.
+void System::SetGroupBy(GroupBy by) { groupBy_ = by; }
+
+bool System::GetTreeView() const { return treeView_; }
+
+// In tree view the rows follow the process tree, siblings in sort key
+// order, instead of being the top processes
+void System::SetTreeView(bool tree) { treeView_ = tree; }
+
+size_t System::GetTreeOffset() const { return treeOffset_; }
+
+void System::SetTreeOffset(size_t offset) { treeOffset_ = offset; }
+
+// Collapses or expands the subtree of pid in tree view
+void System::ToggleCollapsed(int pid) { table_.Tree().Toggle(pid); }
+
+bool System::GetThreadView() const { return threadView_; }
+
+// In thread view the frame also holds the top threads of the rows, or of
+// the process set with SetThreadPid()
+void System::SetThreadView(bool threads) { threadView_ = threads; }
+
+int System::GetThreadPid() const { return threadPid_; }
+
+// 0 goes back to the threads of the rows
+void System::SetThreadPid(int pid) { threadPid_ = pid; }
+
+// Rows leave the fields of columns that are off empty, or -1
+void System::SetColumns(const Columns& columns) { columns_ = columns; }
+
+void System::SetSortKey(SortKey key) { sortKey_ = key; }
+
+Profiler& System::GetProfiler() { return profiler_; }
+
 // TODO: Return the system's kernel identifier (string)
 std::string System::Kernel() { return LinuxParser::Kernel(); }
 
 // TODO: Return the system's memory utilization
-float System::MemoryUtilization() { return LinuxParser::MemoryUtilization(); }
+float System::MemoryUtilization() {
+  if (snapshot_.memTotal == 0) {
+    return 0.0;
+  }
+  float memUsed = snapshot_.memTotal -
+                  (snapshot_.memFree + snapshot_.buffers + snapshot_.cached);
+  return memUsed / snapshot_.memTotal;
+}
 
 // TODO: Return the operating system name
 std::string System::OperatingSystem() { return LinuxParser::OperatingSystem(); }
 
 // TODO: Return the number of processes actively running on the system
-int System::RunningProcesses() { return LinuxParser::RunningProcesses(); }
+int System::RunningProcesses() { return snapshot_.runningProcesses; }
+
+// Processes that started and ended between two refreshes. Only known with
+// the proc connector, a scan of /proc never sees them.
+int System::ShortLivedProcesses() {
+  return connector_ ? connector_->ShortLived() : 0;
+}
 
 // TODO: Return the total number of processes on the system
-int System::TotalProcesses() { return LinuxParser::TotalProcesses(); }
+int System::TotalProcesses() { return snapshot_.totalProcesses; }
 
 // TODO: Return the number of seconds since the system started running
-long int System::UpTime() { return LinuxParser::UpTime(); }
\ No newline at end of file
+long int System::UpTime() { return static_cast<long>(snapshot_.upTime); }
+double System::LoadAverage(int period) {
+  return period >= 0 && period < 3 ? snapshot_.loadAverage[period] : 0.0;
+}
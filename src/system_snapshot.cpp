@@ -0,0 +1,141 @@
+#include "../include/system_snapshot.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+#include "../include/linux_parser.h"
+#include "../include/parse_util.h"
+
+using std::string;
+
+// Sized for every configured core up front, so hot plugging is the only
+// case in which a refresh may still have to grow the array
+SystemSnapshot::SystemSnapshot() {
+  long configured = sysconf(_SC_NPROCESSORS_CONF);
+  cores.resize(configured > 0 ? configured : 1);
+}
+
+// Rereads all four files, returns false if any of them could not be read
+bool SystemSnapshot::Refresh() {
+  bool ok = ParseStat();
+  ok = ParseMeminfo() && ok;
+  ok = ParseUptime() && ok;
+  ok = ParseLoadavg() && ok;
+  return ok;
+}
+
+// Opens the /proc file on first use, or again after a failed read. A
+// file that cannot be opened is reported once, not on every refresh,
+// until it opens again.
+std::size_t SystemSnapshot::Read(ProcFile& file, const string& filename) {
+  if (!file.IsOpen()) {
+    string path{LinuxParser::ProcDirectory() + filename};
+    if (!file.Open(path)) {
+      if (file.FirstFailure()) {
+        perror(("error while opening the file " + path).c_str());
+      }
+      return 0;
+    }
+  }
+  return file.Read();
+}
+
+// Only the "cpu", "cpuN", "processes" and "procs_running" lines are
+// parsed, the per-interrupt lines are skipped with a single memchr each
+bool SystemSnapshot::ParseStat() {
+  std::size_t length = Read(stat_, LinuxParser::kStatFilename);
+  if (length == 0) {
+    return false;
+  }
+
+  const char* p = stat_.Data();
+  const char* end = p + length;
+  long long value{};
+  coreCount = 0;
+  while (p < end) {
+    if (ParseUtil::StartsWith(p, end, "cpu ")) {
+      p += 4;
+      for (auto& jiffies : cpu.jiffies) {
+        p = ParseUtil::ParseLong(p, end, jiffies);
+      }
+    } else if (ParseUtil::StartsWith(p, end, "cpu")) {
+      p = ParseUtil::ParseLong(p + 3, end, value);
+      std::size_t core = static_cast<std::size_t>(value);
+      if (core >= cores.size()) {
+        cores.resize(core + 1);
+      }
+      for (auto& jiffies : cores[core].jiffies) {
+        p = ParseUtil::ParseLong(p, end, jiffies);
+      }
+      coreCount = std::max(coreCount, static_cast<int>(core) + 1);
+    } else if (ParseUtil::StartsWith(p, end, "processes ")) {
+      p = ParseUtil::ParseLong(p + 10, end, value);
+      totalProcesses = static_cast<int>(value);
+    } else if (ParseUtil::StartsWith(p, end, "procs_running ")) {
+      p = ParseUtil::ParseLong(p + 14, end, value);
+      runningProcesses = static_cast<int>(value);
+    }
+    p = ParseUtil::SkipLine(p, end);
+  }
+  return true;
+}
+
+// Stops reading as soon as the four fields we need have been seen
+bool SystemSnapshot::ParseMeminfo() {
+  std::size_t length = Read(meminfo_, LinuxParser::kMeminfoFilename);
+  if (length == 0) {
+    return false;
+  }
+
+  const char* p = meminfo_.Data();
+  const char* end = p + length;
+  int found{0};
+  while (p < end && found < 4) {
+    long long* target{nullptr};
+    if (ParseUtil::StartsWith(p, end, "MemTotal:")) {
+      target = &memTotal;
+    } else if (ParseUtil::StartsWith(p, end, "MemFree:")) {
+      target = &memFree;
+    } else if (ParseUtil::StartsWith(p, end, "Buffers:")) {
+      target = &buffers;
+    } else if (ParseUtil::StartsWith(p, end, "Cached:")) {
+      target = &cached;
+    }
+    if (target != nullptr) {
+      p = ParseUtil::ParseLong(ParseUtil::SkipToken(p, end), end, *target);
+      ++found;
+    }
+    p = ParseUtil::SkipLine(p, end);
+  }
+  return true;
+}
+
+bool SystemSnapshot::ParseUptime() {
+  std::size_t length = Read(uptime_, LinuxParser::kUptimeFilename);
+  if (length == 0) {
+    return false;
+  }
+
+  const char* p = uptime_.Data();
+  const char* end = p + length;
+  p = ParseUtil::ParseDouble(p, end, upTime);
+  ParseUtil::ParseDouble(ParseUtil::SkipSpaces(p, end), end, idleTime);
+  return true;
+}
+
+bool SystemSnapshot::ParseLoadavg() {
+  std::size_t length = Read(loadavg_, LinuxParser::kLoadavgFilename);
+  if (length == 0) {
+    return false;
+  }
+
+  const char* p = loadavg_.Data();
+  const char* end = p + length;
+  for (auto& load : loadAverage) {
+    p = ParseUtil::ParseDouble(ParseUtil::SkipSpaces(p, end), end, load);
+  }
+  return true;
+}
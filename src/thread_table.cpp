@@ -0,0 +1,68 @@
+#include "../include/thread_table.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "../include/linux_parser.h"
+
+using std::vector;
+
+// Threads that exited since the last Read() are left out, and forgotten,
+// as are the threads of processes no longer asked for. The thread count
+// is the one of the process' last sample, so threads a single threaded
+// process started since then show up from the next sample on.
+void ThreadTable::Read(const vector<Process*>& processes,
+                       double systemUpTime) {
+  static const long hertz{sysconf(_SC_CLK_TCK)};
+  ++generation_;
+  threads_.clear();
+  LinuxParser::ProcStatRecord record;
+  for (Process* process : processes) {
+    int pid{process->Pid()};
+    if (process->Threads() <= 1) {
+      tids_.assign(1, pid);
+    } else if (!LinuxParser::Tasks(pid, tids_)) {
+      continue;  // exited
+    }
+    auto now = Clock::now();
+    for (int tid : tids_) {
+      if (!LinuxParser::ParseTaskStat(pid, tid, record)) {
+        continue;
+      }
+      long long ticks{record.utime + record.stime};
+      Sample& sample = samples_[tid];
+      Thread thread{pid, tid, record.state, record.processor};
+      if (sample.generation != 0 && sample.startTime == record.startTime) {
+        double seconds =
+            std::chrono::duration<double>(now - sample.time).count();
+        if (seconds > 0.0) {
+          thread.cpu = static_cast<float>(
+              ((ticks - sample.ticks) * 1.0 / hertz) / seconds);
+        }
+      } else {
+        double seconds = systemUpTime - (record.startTime * 1.0) / hertz;
+        if (seconds > 0.0) {
+          thread.cpu = static_cast<float>((ticks * 1.0 / hertz) / seconds);
+        }
+      }
+      std::size_t length = std::min(std::strlen(record.comm),
+                                    sizeof(thread.name) - 1);
+      std::memcpy(thread.name, record.comm, length);
+      thread.name[length] = '\0';
+      sample = Sample{ticks, record.startTime, now, generation_};
+      threads_.push_back(thread);
+    }
+  }
+
+  for (auto sample = samples_.begin(); sample != samples_.end();) {
+    if (sample->second.generation == generation_) {
+      ++sample;
+    } else {
+      sample = samples_.erase(sample);
+    }
+  }
+}
+
+const vector<Thread>& ThreadTable::Threads() const { return threads_; }
@@ -0,0 +1,84 @@
+// Creates and removes cgroups under a SetRoot() fixture the way a host
+// churning containers or systemd scopes does, and checks that
+// CgroupTable::Paths() stays at the groups alive instead of growing with
+// every group ever seen, and that the ids of removed groups stop being
+// Known(). Exits non-zero on the first check that fails.
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "cgroup_table.h"
+#include "linux_parser.h"
+
+using std::string;
+
+namespace {
+const int kRounds{200};
+const int kGroups{20};  // created and removed in each round
+
+bool Check(bool ok, const char* what, int round) {
+  if (!ok) {
+    std::fprintf(stderr, "round %d: %s\n", round, what);
+  }
+  return ok;
+}
+
+bool Touch(const string& path) {
+  std::FILE* file = std::fopen(path.c_str(), "w");
+  if (file == nullptr) {
+    std::perror(path.c_str());
+    return false;
+  }
+  std::fclose(file);
+  return true;
+}
+}  // namespace
+
+int main() {
+  char root[] = "/tmp/cgroup_table_test.XXXXXX";
+  if (mkdtemp(root) == nullptr) {
+    std::perror("mkdtemp");
+    return 1;
+  }
+  string hierarchy{string(root) + LinuxParser::kCgroupDirectory};
+  if (std::system(("mkdir -p " + hierarchy).c_str()) != 0 ||
+      !Touch(hierarchy + "/cgroup.controllers")) {
+    return 1;
+  }
+  LinuxParser::SetRoot(root);
+
+  CgroupTable table;
+  bool passed{Check(table.Scan(), "no hierarchy found", 0)};
+  std::size_t settled{table.Paths()};
+  for (int round{0}; round < kRounds && passed; ++round) {
+    string parent{hierarchy + "/round" + std::to_string(round) + ".scope"};
+    mkdir(parent.c_str(), 0755);
+    for (int group{0}; group < kGroups; ++group) {
+      mkdir((parent + "/" + std::to_string(group)).c_str(), 0755);
+    }
+    table.Scan();
+    std::uint32_t id{table.Id("/round" + std::to_string(round) +
+                              ".scope/0")};
+    passed = Check(table.Groups().size() == kGroups + 2,
+                   "groups created were not found", round) &&
+             Check(table.Known(id), "id of a live group not known", round);
+    for (int group{0}; group < kGroups; ++group) {
+      rmdir((parent + "/" + std::to_string(group)).c_str());
+    }
+    rmdir(parent.c_str());
+    table.Scan();
+    passed = passed &&
+             Check(table.Groups().size() == 1,
+                   "groups removed were not dropped", round) &&
+             Check(!table.Known(id), "id of a removed group known", round) &&
+             Check(table.Paths() <= settled + kGroups + 1,
+                   "ids of removed groups were not reused", round);
+  }
+  std::printf("%d rounds of %d groups, %zu paths: %s\n", kRounds,
+              kGroups + 1, table.Paths(), passed ? "ok" : "FAILED");
+  std::system(("rm -rf " + string(root)).c_str());
+  return passed ? 0 : 1;
+}
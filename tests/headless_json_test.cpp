@@ -0,0 +1,284 @@
+// Runs the monitor headless over a fixture written by proc_generator, in
+// each view, and checks that every line it writes is one valid JSON
+// document: RFC 8259 syntax, and strings of well-formed UTF-8. The
+// generator's command names include control characters, quotes and
+// multibyte names the kernel's 15 byte limit cuts in half, so the
+// escaping of each view's names is covered. Exits non-zero when any
+// line is invalid.
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using std::string;
+
+namespace {
+const long kProcesses{2000};
+
+// Strict recursive descent over one line; Parse() is true when the whole
+// line is a single value
+class JsonChecker {
+ public:
+  explicit JsonChecker(const string& text) : text_(text) {}
+
+  bool Parse() {
+    SkipSpace();
+    if (!Value(0)) {
+      return false;
+    }
+    SkipSpace();
+    return position_ == text_.size();
+  }
+  size_t Position() const { return position_; }
+
+ private:
+  static const int kMaxDepth{64};
+
+  int Peek() const {
+    return position_ < text_.size()
+               ? static_cast<unsigned char>(text_[position_])
+               : -1;
+  }
+  void SkipSpace() {
+    while (Peek() == ' ' || Peek() == '\t' || Peek() == '\n' ||
+           Peek() == '\r') {
+      ++position_;
+    }
+  }
+  bool Literal(const char* word) {
+    string expected{word};
+    if (text_.compare(position_, expected.size(), expected) != 0) {
+      return false;
+    }
+    position_ += expected.size();
+    return true;
+  }
+  bool Digits() {
+    size_t start{position_};
+    while (Peek() >= '0' && Peek() <= '9') {
+      ++position_;
+    }
+    return position_ > start;
+  }
+  bool Number() {
+    if (Peek() == '-') {
+      ++position_;
+    }
+    if (Peek() == '0') {
+      ++position_;
+    } else if (!Digits()) {
+      return false;
+    }
+    if (Peek() == '.') {
+      ++position_;
+      if (!Digits()) {
+        return false;
+      }
+    }
+    if (Peek() == 'e' || Peek() == 'E') {
+      ++position_;
+      if (Peek() == '+' || Peek() == '-') {
+        ++position_;
+      }
+      if (!Digits()) {
+        return false;
+      }
+    }
+    return true;
+  }
+  // One well-formed UTF-8 sequence of two to four bytes
+  bool Utf8() {
+    int lead{Peek()};
+    int length{0};
+    int low{0x80};
+    int high{0xbf};
+    if (lead >= 0xc2 && lead <= 0xdf) {
+      length = 2;
+    } else if (lead >= 0xe0 && lead <= 0xef) {
+      length = 3;
+      low = lead == 0xe0 ? 0xa0 : low;
+      high = lead == 0xed ? 0x9f : high;
+    } else if (lead >= 0xf0 && lead <= 0xf4) {
+      length = 4;
+      low = lead == 0xf0 ? 0x90 : low;
+      high = lead == 0xf4 ? 0x8f : high;
+    } else {
+      return false;
+    }
+    ++position_;
+    for (int i{1}; i < length; ++i) {
+      if (Peek() < low || Peek() > high) {
+        return false;
+      }
+      ++position_;
+      low = 0x80;
+      high = 0xbf;
+    }
+    return true;
+  }
+  bool String() {
+    ++position_;  // the opening quote
+    for (;;) {
+      int c{Peek()};
+      if (c == '"') {
+        ++position_;
+        return true;
+      }
+      if (c < 0x20) {  // the end of the line, or a raw control character
+        return false;
+      }
+      if (c == '\\') {
+        ++position_;
+        c = Peek();
+        ++position_;
+        if (c == 'u') {
+          for (int i{0}; i < 4; ++i, ++position_) {
+            if (!std::isxdigit(Peek())) {
+              return false;
+            }
+          }
+        } else if (c < 0 || string("\"\\/bfnrt").find(
+                                static_cast<char>(c)) == string::npos) {
+          return false;
+        }
+      } else if (c >= 0x80) {
+        if (!Utf8()) {
+          return false;
+        }
+      } else {
+        ++position_;
+      }
+    }
+  }
+  bool Value(int depth) {
+    if (depth > kMaxDepth) {
+      return false;
+    }
+    switch (Peek()) {
+      case '{': return Members('}', depth, true);
+      case '[': return Members(']', depth, false);
+      case '"': return String();
+      case 't': return Literal("true");
+      case 'f': return Literal("false");
+      case 'n': return Literal("null");
+      default: return Number();
+    }
+  }
+  // An object's "key":value pairs, or an array's values, up to close
+  bool Members(char close, int depth, bool keyed) {
+    ++position_;
+    SkipSpace();
+    if (Peek() == close) {
+      ++position_;
+      return true;
+    }
+    for (;;) {
+      SkipSpace();
+      if (keyed) {
+        if (Peek() != '"' || !String()) {
+          return false;
+        }
+        SkipSpace();
+        if (Peek() != ':') {
+          return false;
+        }
+        ++position_;
+        SkipSpace();
+      }
+      if (!Value(depth + 1)) {
+        return false;
+      }
+      SkipSpace();
+      if (Peek() == close) {
+        ++position_;
+        return true;
+      }
+      if (Peek() != ',') {
+        return false;
+      }
+      ++position_;
+    }
+  }
+
+  const string& text_;
+  size_t position_{0};
+};
+
+bool Run(const string& command) {
+  if (std::system(command.c_str()) != 0) {
+    std::fprintf(stderr, "failed: %s\n", command.c_str());
+    return false;
+  }
+  return true;
+}
+
+// Runs the monitor with options and checks each line it wrote. Counts
+// the lines, and the replaced bytes seen in them.
+bool CheckView(const string& root, const string& options, long& lines,
+               long& replaced) {
+  string output{root + "/headless.json"};
+  std::remove(output.c_str());  // the monitor appends
+  string command{string(MONITOR) + " -r " + root +
+                 " --headless -c 2 -i 10 -n 2000 " + options + " -o " +
+                 output};
+  if (!Run(command)) {
+    return false;
+  }
+  std::FILE* file = std::fopen(output.c_str(), "r");
+  if (file == nullptr) {
+    std::perror(output.c_str());
+    return false;
+  }
+  string line;
+  bool valid{true};
+  lines = 0;
+  replaced = 0;
+  for (int c{std::fgetc(file)}; c != EOF && valid; c = std::fgetc(file)) {
+    if (c != '\n') {
+      line += static_cast<char>(c);
+      continue;
+    }
+    ++lines;
+    JsonChecker checker(line);
+    if (!checker.Parse()) {
+      std::fprintf(stderr, "%s: line %ld is not valid JSON at byte %zu\n",
+                   options.c_str(), lines, checker.Position());
+      valid = false;
+    }
+    for (size_t at{line.find("\\ufffd")}; at != string::npos;
+         at = line.find("\\ufffd", at + 1)) {
+      ++replaced;
+    }
+    line.clear();
+  }
+  std::fclose(file);
+  if (valid && !line.empty()) {
+    std::fprintf(stderr, "%s: last line is not terminated\n",
+                 options.c_str());
+    valid = false;
+  }
+  return valid;
+}
+}  // namespace
+
+int main() {
+  // Written again each run, so it always matches the generator
+  string root{TEST_FIXTURE};
+  if (!Run("rm -rf " + root + " && " + PROC_GENERATOR + " " + root +
+           " -n " + std::to_string(kProcesses) + " > /dev/null")) {
+    return 1;
+  }
+  const char* const views[] = {"", "-g command", "-g user", "-g cgroup",
+                               "-T", "-H"};
+  bool passed{true};
+  for (const char* options : views) {
+    long lines{0};
+    long replaced{0};
+    bool valid{CheckView(root, options, lines, replaced)};
+    std::printf("%-12s %ld lines, %ld replaced bytes: %s\n",
+                *options != '\0' ? options : "processes", lines, replaced,
+                valid ? "ok" : "FAILED");
+    passed = passed && valid && lines > 0;
+  }
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,694 @@
+// Writes a synthetic /proc tree for running the monitor against far more
+// processes than a development machine has:
+//
+//   proc_generator DIR -n 100000
+//   monitor --root DIR
+//
+// DIR/proc gets the system wide files the monitor reads plus stat, status,
+// cmdline, smaps_rollup, io and cgroup for every process, and the stat of
+// its first kMaxTasks threads below task, plus diskstats and net/dev;
+// DIR/etc gets passwd and os-release; DIR/sys/fs/cgroup gets a cgroup v2
+// hierarchy of services, users and containers holding the processes.
+// Generate into an empty directory, pid directories left over from a
+// larger run are not removed. The same seed always writes the same tree.
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using std::string;
+
+namespace {
+// The kernel keeps at most 15 bytes of a command name
+const std::size_t kCommLength{15};
+const long kClockTicks{100};
+const long kPageKb{4};
+// Threads written below task/ per process. stat and status count them
+// all, like a process with up to 200 threads would, but a full task/
+// tree would take up more room than the processes themselves.
+const long kMaxTasks{8};
+
+struct Settings {
+  string directory;
+  long processes{10000};
+  int cores{8};
+  unsigned seed{1};
+  int users{40};
+};
+
+// A kind of process: its command name and a command line to go with it
+struct Program {
+  const char* comm;
+  const char* cmdline;  // arguments separated by spaces, "" for none
+};
+
+const Program kPrograms[] = {
+    {"systemd", "/lib/systemd/systemd --user"},
+    {"bash", "-bash"},
+    {"sshd", "sshd: deploy [priv]"},
+    {"python3", "python3 -m http.server 8000"},
+    {"postgres", "postgres: checkpointer"},
+    {"nginx", "nginx: worker process"},
+    {"node", "node /srv/app/server.js --port=3000"},
+    {"java", "java -Xmx4g -cp /opt/app/lib/* com.example.Main"},
+    {"chrome",
+     "/opt/google/chrome/chrome --type=renderer --enable-features=A,B,C"},
+    {"containerd-shim", "/usr/bin/containerd-shim-runc-v2 -namespace moby"},
+    {"Web Content", "/usr/lib/firefox/firefox -contentproc -childID 7"},
+};
+
+// Names that break naive parsers: blanks, parentheses, control
+// characters, multi byte UTF-8 cut by the 15 byte limit
+const char* const kAwkwardNames[] = {
+    "(sd-pam)",
+    "evil) R 1 (",
+    "a b c",
+    ")",
+    "x)y)z",
+    "tab\tname",
+    "new\nline",
+    "back\\slash",
+    "   ",
+    "",
+    "%s%n%d",
+    "\xc3\xbc\xc3\xb1\xc3\xaf\xc3\xa7\xc3\xb8\xc3\xb0\xc3\xa9\xc3\xa4",
+    "a-very-long-process-name-that-gets-truncated",
+};
+
+// Names of threads besides the first, which has the process' name
+const char* const kThreadNames[] = {
+    "worker-%ld",   "GC Thread#%ld",   "tokio-runtime-w",
+    "pool-1-thr-%ld", "C2 CompilerThre", "IO-%ld",
+};
+
+const char* const kKernelThreads[] = {
+    "kworker/%d:1-events", "ksoftirqd/%d", "migration/%d", "cpuhp/%d",
+    "kworker/u%d:2-flush", "rcu_preempt",  "kthreadd",
+};
+
+class Generator {
+ public:
+  explicit Generator(const Settings& settings)
+      : settings_(settings),
+        random_(settings.seed),
+        taskRandom_(settings.seed + 1) {}
+  bool Run();
+
+ private:
+  long Uniform(long low, long high) {
+    return std::uniform_int_distribution<long>(low, high)(random_);
+  }
+  bool Chance(double probability) {
+    return std::bernoulli_distribution(probability)(random_);
+  }
+  bool WriteProcess(int pid, int ppid);
+  bool WriteTasks(const string& directory, int pid, const string& comm,
+                  char state, int ppid, long threads, long utime,
+                  long stime, long startTime, long vsizeKb, long rssKb);
+  bool WriteSystem();
+  bool WriteDevices();
+  bool WriteEtc();
+  bool WriteCgroups();
+
+  // Counters of a cgroup, the processes of its subgroups included
+  struct CgroupUsage {
+    long long usageUsec{};
+    long long anon{};  // bytes
+    long long file{};
+    long long readBytes{};
+    long long writeBytes{};
+  };
+
+  Settings settings_;
+  std::mt19937 random_;
+  // Of the task/ trees only, so adding them left the rest as it was
+  std::mt19937 taskRandom_;
+  int nextTid_{0};
+  string proc_;
+  long upTime_{0};  // seconds
+  long running_{0};
+  int lastPid_{0};
+  std::map<string, CgroupUsage> cgroups_;  // parents sort before children
+};
+
+bool MakeDirectory(const string& path) {
+  if (mkdir(path.c_str(), 0755) != 0 && errno != EEXIST) {
+    perror(("error while creating the directory " + path).c_str());
+    return false;
+  }
+  return true;
+}
+
+bool WriteFile(const string& path, const string& data) {
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    perror(("error while opening the file " + path).c_str());
+    return false;
+  }
+  std::size_t written{0};
+  while (written < data.size()) {
+    ssize_t count = write(fd, data.data() + written, data.size() - written);
+    if (count < 0) {
+      perror(("error while writing file " + path).c_str());
+      close(fd);
+      return false;
+    }
+    written += static_cast<std::size_t>(count);
+  }
+  close(fd);
+  return true;
+}
+
+// printf into a string
+template <typename... Args>
+string Format(const char* format, Args... args) {
+  int length = std::snprintf(nullptr, 0, format, args...);
+  string text(static_cast<std::size_t>(length), '\0');
+  std::snprintf(&text[0], text.size() + 1, format, args...);
+  return text;
+}
+
+// All 52 fields of a stat file in the kernel's order; an address of 0 for
+// kernel threads, which show none
+string StatLine(int pid, const string& comm, char state, int ppid, int pgrp,
+                unsigned flags, long minorFaults, long majorFaults,
+                long utime, long stime, long threads, long startTime,
+                long vsizeKb, long rssKb, int processor, long address) {
+  string stat = Format(
+      "%d (%s) %c %d %d %d 0 -1 %u %ld 0 %ld 0 %ld %ld 0 0 20 0 %ld 0 %ld "
+      "%ld %ld 18446744073709551615 ",
+      pid, comm.c_str(), state, ppid, pgrp, pgrp, flags, minorFaults,
+      majorFaults, utime, stime, threads, startTime, vsizeKb * 1024,
+      rssKb / kPageKb);
+  stat += Format(
+      "%ld %ld %ld 0 0 0 0 4096 16386 0 0 0 17 %d 0 0 0 0 0 "
+      "%ld %ld %ld %ld %ld %ld %ld 0\n",
+      address, address, address, processor, address, address, address,
+      address, address, address, address);
+  return stat;
+}
+
+// /proc/[pid]/status shows the name with tabs, newlines and backslashes
+// escaped, /proc/[pid]/stat shows it raw
+string EscapeName(const string& name) {
+  string escaped;
+  for (char c : name) {
+    if (c == '\t') {
+      escaped += "\\t";
+    } else if (c == '\n') {
+      escaped += "\\n";
+    } else if (c == '\\') {
+      escaped += "\\\\";
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+bool Generator::Run() {
+  proc_ = settings_.directory + "/proc";
+  if (!MakeDirectory(settings_.directory) || !MakeDirectory(proc_) ||
+      !MakeDirectory(settings_.directory + "/etc")) {
+    return false;
+  }
+  upTime_ = Uniform(3600, 90 * 86400);
+  // Threads other than the first get ids above every pid of the run
+  nextTid_ = static_cast<int>(settings_.processes * 8 + 100);
+
+  // Pids climb with gaps, like a machine that has forked a lot since boot
+  std::vector<int> parents{1};
+  int pid{0};
+  for (long i{0}; i < settings_.processes; ++i) {
+    pid += i < 2 ? 1 : static_cast<int>(Uniform(1, 8));
+    int ppid{0};
+    if (pid == 2) {
+      ppid = 0;
+    } else if (pid > 2) {
+      ppid = parents[Uniform(0, static_cast<long>(parents.size()) - 1)];
+    }
+    if (!WriteProcess(pid, ppid)) {
+      return false;
+    }
+    if (pid > 2 && parents.size() < 4096 && Chance(0.05)) {
+      parents.push_back(pid);
+    }
+  }
+  lastPid_ = pid;
+  return WriteSystem() && WriteDevices() && WriteEtc() && WriteCgroups();
+}
+
+bool Generator::WriteProcess(int pid, int ppid) {
+  bool kernel = pid == 2 || (pid > 2 && Chance(0.05));
+  bool zombie = !kernel && Chance(0.01);
+  string comm;
+  string cmdline;
+  int uid{0};
+  if (pid == 1) {
+    comm = "systemd";
+    cmdline = "/sbin/init splash";
+  } else if (kernel) {
+    ppid = pid == 2 ? 0 : 2;
+    const char* name =
+        kKernelThreads[Uniform(0, std::size(kKernelThreads) - 1)];
+    comm = Format(name, static_cast<int>(Uniform(0, settings_.cores - 1)));
+  } else if (Chance(0.02)) {
+    comm = kAwkwardNames[Uniform(0, std::size(kAwkwardNames) - 1)];
+    cmdline = comm + " --awkward";
+    uid = 1000 + static_cast<int>(Uniform(0, settings_.users - 1));
+  } else {
+    const Program& program = kPrograms[Uniform(0, std::size(kPrograms) - 1)];
+    comm = program.comm;
+    cmdline = program.cmdline;
+    if (Chance(0.1)) {
+      // A few very long command lines, like a JVM with a full classpath
+      for (long jar = Uniform(50, 400); jar > 0; --jar) {
+        cmdline += Format(" /opt/app/lib/dependency-%ld.jar", jar);
+      }
+    }
+    int user = static_cast<int>(Uniform(0, settings_.users - 1));
+    uid = Chance(0.3) ? 0 : 1000 + user;
+  }
+  if (zombie) {
+    cmdline.clear();  // a zombie's memory, and its arguments, are gone
+  }
+  comm.resize(std::min(comm.size(), kCommLength));
+  std::replace(cmdline.begin(), cmdline.end(), ' ', '\0');
+  if (!cmdline.empty()) {
+    cmdline += '\0';
+  }
+
+  char state = zombie ? 'Z' : kernel ? 'I' : 'S';
+  if (!zombie && running_ < 2 * settings_.cores && Chance(0.02)) {
+    state = 'R';
+    ++running_;
+  } else if (!zombie && Chance(0.01)) {
+    state = 'D';
+  }
+  long threads = kernel || zombie ? 1 : Chance(0.8) ? 1 : Uniform(2, 200);
+  long startTime = Uniform(0, upTime_ * kClockTicks);
+  long lifetime = upTime_ * kClockTicks - startTime;
+  long utime = kernel ? Uniform(0, lifetime / 1000 + 1)
+                      : Uniform(0, lifetime / 20 + 1);
+  long stime = utime / Uniform(2, 10);
+  long vsizeKb = kernel || zombie ? 0 : Uniform(4 << 10, 16 << 20);
+  long rssKb = kernel || zombie ? 0 : Uniform(512, vsizeKb / 4 + 1024);
+  int processor = static_cast<int>(Uniform(0, settings_.cores - 1));
+  unsigned flags = kernel ? 0x04208040u : 0x00400100u;
+
+  string directory = proc_ + "/" + std::to_string(pid);
+  if (!MakeDirectory(directory)) {
+    return false;
+  }
+
+  long address = kernel ? 0 : 0x55d0c0de0000L + Uniform(0, 1 << 20) * 4096;
+  string stat =
+      StatLine(pid, comm, state, ppid, pid, flags, Uniform(0, 100000),
+               Uniform(0, 500), utime, stime, threads, startTime, vsizeKb,
+               rssKb, processor, address);
+
+  string status = Format(
+      "Name:\t%s\nUmask:\t0022\nState:\t%c (%s)\nTgid:\t%d\nNgid:\t0\n"
+      "Pid:\t%d\nPPid:\t%d\nTracerPid:\t0\nUid:\t%d\t%d\t%d\t%d\n"
+      "Gid:\t%d\t%d\t%d\t%d\nFDSize:\t64\nGroups:\t\n",
+      EscapeName(comm).c_str(), state,
+      state == 'R'   ? "running"
+      : state == 'Z' ? "zombie"
+      : state == 'D' ? "disk sleep"
+      : state == 'I' ? "idle"
+                     : "sleeping",
+      pid, pid, ppid, uid, uid, uid, uid, uid, uid, uid, uid);
+  // Part of the resident set is shared with other processes, and a few
+  // processes have some of their memory swapped out
+  long sharedKb = rssKb / Uniform(2, 8);
+  long swapKb = Chance(0.1) ? Uniform(0, rssKb / 2 + 1) : 0;
+  if (!kernel && !zombie) {
+    status += Format(
+        "VmPeak:\t%8ld kB\nVmSize:\t%8ld kB\nVmLck:\t       0 kB\n"
+        "VmPin:\t       0 kB\nVmHWM:\t%8ld kB\nVmRSS:\t%8ld kB\n"
+        "RssAnon:\t%8ld kB\nRssFile:\t%8ld kB\nRssShmem:\t       0 kB\n"
+        "VmData:\t%8ld kB\nVmStk:\t     132 kB\nVmExe:\t     888 kB\n"
+        "VmLib:\t    2048 kB\nVmPTE:\t      96 kB\nVmSwap:\t%8ld kB\n",
+        vsizeKb, vsizeKb, rssKb, rssKb, rssKb * 3 / 4, rssKb / 4, vsizeKb / 2,
+        swapKb);
+  }
+  status += Format(
+      "Threads:\t%ld\nSigQ:\t0/63448\nSigPnd:\t0000000000000000\n"
+      "ShdPnd:\t0000000000000000\nSigBlk:\t0000000000000000\n"
+      "SigIgn:\t0000000000001000\nSigCgt:\t0000000180004002\n"
+      "CapInh:\t0000000000000000\nCapPrm:\t0000000000000000\n"
+      "CapEff:\t0000000000000000\nCapBnd:\t000001ffffffffff\n"
+      "Seccomp:\t0\nCpus_allowed:\tff\nCpus_allowed_list:\t0-%d\n"
+      "Mems_allowed_list:\t0\nvoluntary_ctxt_switches:\t%ld\n"
+      "nonvoluntary_ctxt_switches:\t%ld\n",
+      threads, settings_.cores - 1, Uniform(0, 1000000), Uniform(0, 10000));
+
+  // Empty for processes without memory, like the kernel's
+  string smaps;
+  if (!kernel && !zombie) {
+    long privateKb = rssKb - sharedKb;
+    smaps = Format(
+        "%012lx-7ffd2c1f2000 ---p 00000000 00:00 0      [rollup]\n"
+        "Rss:            %8ld kB\nPss:            %8ld kB\n"
+        "Shared_Clean:   %8ld kB\nShared_Dirty:          0 kB\n"
+        "Private_Clean:  %8ld kB\nPrivate_Dirty:  %8ld kB\n"
+        "Referenced:     %8ld kB\nAnonymous:      %8ld kB\n"
+        "Swap:           %8ld kB\nSwapPss:        %8ld kB\n"
+        "Locked:                0 kB\n",
+        address, rssKb, privateKb + sharedKb / Uniform(2, 20), sharedKb,
+        privateKb / 4, privateKb - privateKb / 4, rssKb, privateKb * 3 / 4,
+        swapKb, swapKb);
+  }
+
+  // Kernel threads stay in the root group, users get a slice each and
+  // root's programs are services or containers
+  string cgroup{"/"};
+  if (pid == 1) {
+    cgroup = "/init.scope";
+  } else if (kernel || zombie) {
+    cgroup = "/";
+  } else if (uid != 0) {
+    cgroup = Format("/user.slice/user-%d.slice", uid);
+  } else if (Chance(0.5)) {
+    cgroup = Format("/system.slice/%s.service", comm.c_str());
+  } else {
+    cgroup = Format("/kubepods.slice/pod%02ld/container%ld", Uniform(0, 19),
+                    Uniform(0, 2));
+  }
+  long long readBytes{Uniform(0, 1L << 30)};
+  long long writeBytes{Uniform(0, 1L << 28)};
+  for (string group{cgroup};;) {
+    CgroupUsage& usage = cgroups_[group];
+    usage.usageUsec += (utime + stime) * (1000000 / kClockTicks);
+    usage.anon += rssKb * 1024 * 3 / 4;
+    usage.file += rssKb * 1024 / 4;
+    usage.readBytes += readBytes;
+    usage.writeBytes += writeBytes;
+    if (group == "/") {
+      break;
+    }
+    std::size_t slash = group.rfind('/');
+    group = slash == 0 ? "/" : group.substr(0, slash);
+  }
+  // The same bytes as the cgroup is charged, in calls of 4 to 64 kB
+  string io = Format(
+      "rchar: %lld\nwchar: %lld\nsyscr: %lld\nsyscw: %lld\n"
+      "read_bytes: %lld\nwrite_bytes: %lld\ncancelled_write_bytes: 0\n",
+      readBytes * 2, writeBytes, readBytes / 4096 + utime,
+      writeBytes / 65536 + stime, readBytes, writeBytes);
+
+  return WriteFile(directory + "/stat", stat) &&
+         WriteFile(directory + "/status", status) &&
+         WriteFile(directory + "/cmdline", cmdline) &&
+         WriteFile(directory + "/smaps_rollup", smaps) &&
+         WriteFile(directory + "/io", io) &&
+         WriteFile(directory + "/cgroup", "0::" + cgroup + "\n") &&
+         WriteTasks(directory, pid, comm, state, ppid, threads, utime, stime,
+                    startTime, vsizeKb, rssKb);
+}
+
+// The first thread has the pid and name of the process, the others split
+// its CPU time between them, each taking a random part of what is left.
+// The first thread gets the rest.
+bool Generator::WriteTasks(const string& directory, int pid,
+                           const string& comm, char state, int ppid,
+                           long threads, long utime, long stime,
+                           long startTime, long vsizeKb, long rssKb) {
+  auto uniform = [this](long low, long high) {
+    return std::uniform_int_distribution<long>(low, high)(taskRandom_);
+  };
+  string tasks{directory + "/task"};
+  if (!MakeDirectory(tasks)) {
+    return false;
+  }
+  long written{std::min(threads, kMaxTasks)};
+  for (long task{written - 1}; task >= 0; --task) {
+    int tid{task == 0 ? pid : nextTid_++};
+    string name{comm};
+    long taskUtime{utime};
+    long taskStime{stime};
+    char taskState{task == 0 ? state : 'S'};
+    if (task > 0) {
+      name = Format(kThreadNames[uniform(0, std::size(kThreadNames) - 1)],
+                    task);
+      name.resize(std::min(name.size(), kCommLength));
+      taskUtime = uniform(0, utime / 2);
+      taskStime = uniform(0, stime / 2);
+      utime -= taskUtime;
+      stime -= taskStime;
+    }
+    string taskDirectory{tasks + "/" + std::to_string(tid)};
+    int processor{static_cast<int>(uniform(0, settings_.cores - 1))};
+    if (!MakeDirectory(taskDirectory) ||
+        !WriteFile(taskDirectory + "/stat",
+                   StatLine(tid, name, taskState, ppid, pid, 0x00400040u,
+                            uniform(0, 10000), uniform(0, 50), taskUtime,
+                            taskStime, threads, startTime, vsizeKb, rssKb,
+                            processor, 0))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// One directory per group with the files the monitor reads. The root
+// group has no memory.current, like the kernel's.
+bool Generator::WriteCgroups() {
+  string root = settings_.directory + "/sys/fs/cgroup";
+  if (!MakeDirectory(settings_.directory + "/sys") ||
+      !MakeDirectory(settings_.directory + "/sys/fs") ||
+      !MakeDirectory(root) ||
+      !WriteFile(root + "/cgroup.controllers", "cpuset cpu io memory pids\n")) {
+    return false;
+  }
+  for (const auto& [group, usage] : cgroups_) {
+    string directory = group == "/" ? root : root + group;
+    if (!MakeDirectory(directory)) {
+      return false;
+    }
+    long long throttled = Chance(0.1) ? usage.usageUsec / 50 : 0;
+    string cpu = Format(
+        "usage_usec %lld\nuser_usec %lld\nsystem_usec %lld\n"
+        "nr_periods %lld\nnr_throttled %lld\nthrottled_usec %lld\n",
+        usage.usageUsec, usage.usageUsec * 4 / 5, usage.usageUsec / 5,
+        usage.usageUsec / 100000, throttled / 100000, throttled);
+    string memory = Format(
+        "anon %lld\nfile %lld\nkernel %lld\nkernel_stack %lld\n"
+        "pagetables %lld\nsock 0\nshmem %lld\n",
+        usage.anon, usage.file, usage.anon / 50, usage.anon / 500,
+        usage.anon / 200, usage.file / 10);
+    string io = Format(
+        "259:0 rbytes=%lld wbytes=%lld rios=%lld wios=%lld dbytes=0 "
+        "dios=0\n8:0 rbytes=%lld wbytes=0 rios=%lld wios=0 dbytes=0 "
+        "dios=0\n",
+        usage.readBytes, usage.writeBytes, usage.readBytes / 4096,
+        usage.writeBytes / 4096, usage.readBytes / 8,
+        usage.readBytes / 32768);
+    if (!WriteFile(directory + "/cpu.stat", cpu) ||
+        !WriteFile(directory + "/memory.stat", memory) ||
+        !WriteFile(directory + "/io.stat", io) ||
+        (group != "/" &&
+         !WriteFile(directory + "/memory.current",
+                    Format("%lld\n", usage.anon + usage.file)))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Generator::WriteSystem() {
+  long total = upTime_ * kClockTicks;
+  // user nice system idle iowait irq softirq, the aggregate line is the
+  // sum of the cores like the kernel's
+  long sum[7] = {};
+  string cores;
+  for (int core{0}; core < settings_.cores; ++core) {
+    long jiffies[7];
+    jiffies[0] = Uniform(total / 20, total / 4);
+    jiffies[1] = Uniform(0, total / 100);
+    jiffies[2] = jiffies[0] / Uniform(2, 6);
+    jiffies[4] = Uniform(0, total / 100);
+    jiffies[5] = Uniform(0, total / 1000);
+    jiffies[6] = Uniform(0, total / 500);
+    jiffies[3] = std::max(0L, total - jiffies[0] - jiffies[1] - jiffies[2] -
+                                  jiffies[4] - jiffies[5] - jiffies[6]);
+    cores += "cpu" + std::to_string(core);
+    for (int i{0}; i < 7; ++i) {
+      cores += " " + std::to_string(jiffies[i]);
+      sum[i] += jiffies[i];
+    }
+    cores += " 0 0 0\n";
+  }
+  string stat = "cpu ";
+  for (long jiffies : sum) {
+    stat += " " + std::to_string(jiffies);
+  }
+  stat += " 0 0 0\n" + cores;
+  stat += "intr " + std::to_string(Uniform(1000000, 1000000000));
+  for (int line{0}; line < 512; ++line) {
+    stat += line % 7 == 0 ? " 3" : " 0";
+  }
+  stat += Format(
+      "\nctxt %ld\nbtime %ld\nprocesses %d\nprocs_running %ld\n"
+      "procs_blocked 0\nsoftirq %ld 0 1 2 3 4 5 6 7 8 9\n",
+      Uniform(1000000, 10000000000), 1700000000L - upTime_, lastPid_,
+      std::max(1L, running_), Uniform(1000000, 1000000000));
+
+  long memTotal = 1024L * 1024 * std::max(8L, settings_.processes / 500);
+  long memFree = memTotal / Uniform(3, 10);
+  string meminfo = Format(
+      "MemTotal:       %ld kB\nMemFree:        %ld kB\n"
+      "MemAvailable:   %ld kB\nBuffers:        %ld kB\n"
+      "Cached:         %ld kB\nSwapCached:            0 kB\n"
+      "Active:         %ld kB\nInactive:       %ld kB\n"
+      "SwapTotal:             0 kB\nSwapFree:              0 kB\n"
+      "Dirty:              128 kB\nShmem:          %ld kB\n"
+      "Slab:           %ld kB\nPageTables:     %ld kB\n",
+      memTotal, memFree, memFree * 2, memTotal / 50, memTotal / 5,
+      memTotal / 2, memTotal / 4, memTotal / 100, memTotal / 40,
+      memTotal / 200);
+
+  double load = static_cast<double>(running_) / settings_.cores;
+  return WriteFile(proc_ + "/stat", stat) &&
+         WriteFile(proc_ + "/meminfo", meminfo) &&
+         WriteFile(proc_ + "/uptime",
+                   Format("%ld.%02ld %ld.00\n", upTime_, Uniform(0, 99),
+                          upTime_ * settings_.cores / 2)) &&
+         WriteFile(proc_ + "/loadavg",
+                   Format("%.2f %.2f %.2f %ld/%ld %d\n", load, load * 0.9,
+                          load * 0.8, std::max(1L, running_),
+                          settings_.processes, lastPid_)) &&
+         WriteFile(proc_ + "/version",
+                   "Linux version 6.1.0-synthetic (generator@localhost) "
+                   "(gcc 12.2.0) #1 SMP PREEMPT_DYNAMIC\n");
+}
+
+// Disks with partitions, a device mapper volume and an unused loop device,
+// and interfaces of a container host. The counters follow from the uptime
+// alone, so the processes are the same as without them.
+bool Generator::WriteDevices() {
+  struct Disk {
+    int major;
+    int minor;
+    const char* name;
+    long share;  // of the I/O of the busiest disk, in percent
+  };
+  const Disk disks[] = {
+      {7, 0, "loop0", 0},      {259, 0, "nvme0n1", 100},
+      {259, 1, "nvme0n1p1", 2}, {259, 2, "nvme0n1p2", 98},
+      {8, 0, "sda", 30},       {8, 1, "sda1", 30},
+      {253, 0, "dm-0", 90},
+  };
+  string diskstats;
+  for (const Disk& disk : disks) {
+    long reads{upTime_ * 40 * disk.share / 100};
+    long writes{upTime_ * 25 * disk.share / 100};
+    diskstats += Format(
+        "%4d %7d %s %ld %ld %ld %ld %ld %ld %ld %ld 0 %ld %ld 0 0 0 0 0 0\n",
+        disk.major, disk.minor, disk.name, reads, reads / 10, reads * 16,
+        reads / 4, writes, writes / 3, writes * 24, writes, reads / 8,
+        reads / 3 + writes);
+  }
+
+  string netDev{
+      "Inter-|   Receive                                                |  "
+      "Transmit\n face |bytes    packets errs drop fifo frame compressed "
+      "multicast|bytes    packets errs drop fifo colls carrier compressed\n"};
+  const char* const interfaces[] = {"lo", "eth0", "docker0", "veth1a2b3c",
+                                    "veth4d5e6f"};
+  long share{100};
+  for (const char* name : interfaces) {
+    long packets{upTime_ * 300 * share / 100};
+    netDev += Format(
+        "%6s: %ld %ld 0 %ld 0 0 0 0 %ld %ld 0 %ld 0 0 0 0\n", name,
+        packets * 900, packets, packets / 5000, packets * 600,
+        packets * 9 / 10, packets / 20000);
+    share = share * 2 / 3;
+  }
+  return MakeDirectory(proc_ + "/net") &&
+         WriteFile(proc_ + "/diskstats", diskstats) &&
+         WriteFile(proc_ + "/net/dev", netDev);
+}
+
+bool Generator::WriteEtc() {
+  string passwd{
+      "root:x:0:0:root:/root:/bin/bash\n"
+      "daemon:x:1:1:daemon:/usr/sbin:/usr/sbin/nologin\n"};
+  for (int user{0}; user < settings_.users; ++user) {
+    passwd += Format("user%03d:x:%d:%d::/home/user%03d:/bin/bash\n", user,
+                     1000 + user, 1000 + user, user);
+  }
+  passwd += "nobody:x:65534:65534:nobody:/nonexistent:/usr/sbin/nologin\n";
+  string etc = settings_.directory + "/etc";
+  return WriteFile(etc + "/passwd", passwd) &&
+         WriteFile(etc + "/os-release",
+                   Format("NAME=\"Synthetic\"\nPRETTY_NAME=\"Synthetic "
+                          "Linux (%ld processes)\"\nID=synthetic\n",
+                          settings_.processes));
+}
+
+void Usage(const char* program) {
+  std::fprintf(stderr,
+               "usage: %s DIR [options]\n"
+               "  -n, --processes N   processes to write (10000)\n"
+               "  -c, --cores N       cores in DIR/proc/stat (8)\n"
+               "  -u, --users N       users besides root (40)\n"
+               "  -s, --seed N        random seed (1)\n",
+               program);
+}
+
+bool Parse(int argc, char* argv[], Settings& settings) {
+  for (int i{1}; i < argc; ++i) {
+    string arg{argv[i]};
+    long value{0};
+    if (arg[0] != '-' && settings.directory.empty()) {
+      settings.directory = arg;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      return false;
+    }
+    try {
+      value = std::stol(argv[++i]);
+    } catch (const std::exception&) {
+      return false;
+    }
+    if (value <= 0) {
+      return false;
+    } else if (arg == "-n" || arg == "--processes") {
+      settings.processes = value;
+    } else if (arg == "-c" || arg == "--cores") {
+      settings.cores = static_cast<int>(value);
+    } else if (arg == "-u" || arg == "--users") {
+      settings.users = static_cast<int>(value);
+    } else if (arg == "-s" || arg == "--seed") {
+      settings.seed = static_cast<unsigned>(value);
+    } else {
+      return false;
+    }
+  }
+  return !settings.directory.empty();
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Settings settings;
+  if (!Parse(argc, argv, settings)) {
+    Usage(argv[0]);
+    return 2;
+  }
+  if (!Generator(settings).Run()) {
+    return 1;
+  }
+  std::printf("wrote %ld processes to %s/proc\n", settings.processes,
+              settings.directory.c_str());
+  return 0;
+}